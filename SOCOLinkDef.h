@@ -7,5 +7,7 @@
 #pragma link C++ class SOCO::Hit+;
 #pragma link C++ class std::vector<SOCO::Hit>+;
 #pragma link C++ class SOCO::Event+;
+#pragma link C++ class SOCO::Calibration+;
+#pragma link C++ class SOCO::IdDictionary+;
 
 #endif
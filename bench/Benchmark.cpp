@@ -0,0 +1,257 @@
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Throughput benchmarks for EventReader and Soco2Root
+// Input files are usually generated with soco-gen. Times are measured with a warm page cache.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include "Calibration.h"
+#include "EventBuilder.h"
+#include "EventReader.h"
+#include "FSUtils.h"
+#include "HitKernels.h"
+#include "Soco2Root.h"
+
+namespace
+{
+
+struct Benchmark
+{
+    std::string name;
+    // processes all events of the file
+    std::function<void(const std::string&)> run;
+};
+
+// Keeps the compiler from optimizing away the decoded values
+volatile uint64_t sink;
+
+void scanViews(SOCO::EventReader& reader)
+{
+    uint64_t sum = 0;
+    SOCO::EventView view;
+    while (reader.getNextEventView(view))
+    {
+        for (const SOCO::HitView hit : view)
+        {
+            sum += hit.adc();
+        }
+    }
+    sink = sum;
+}
+
+std::vector<Benchmark> benchmarks(const std::string& output_dir, const size_t stream_memory)
+{
+    auto convert = [output_dir](const std::string& input, OutputLayout layout, bool pipeline) {
+        const std::string output = SOCO::FSUtils::buildFilename(input, output_dir, ".bench.root");
+        Soco2RootOptions options;
+        options.layout   = layout;
+        options.pipeline = pipeline;
+        Soco2Root s2r(input, output, options);
+        s2r.process();
+        std::remove(output.c_str());
+    };
+
+    return {
+        {"mapFile mmap + scan",
+         [](const std::string& input) {
+             SOCO::EventReader reader;
+             reader.mapFile(input, true);
+             scanViews(reader);
+         }},
+        {"mapFile read() + scan",
+         [](const std::string& input) {
+             SOCO::EventReader reader;
+             reader.mapFile(input, false);
+             scanViews(reader);
+         }},
+        {"mapFile stream + scan",
+         [stream_memory](const std::string& input) {
+             SOCO::EventReader reader;
+             reader.mapFile(input, false, stream_memory);
+             scanViews(reader);
+         }},
+        {"getNextEvent",
+         [](const std::string& input) {
+             SOCO::EventReader reader;
+             reader.mapFile(input);
+             SOCO::Event event;
+             uint64_t sum = 0;
+             while (reader.getNextEvent(event))
+             {
+                 sum += event.hits.size();
+             }
+             sink = sum;
+         }},
+        {"readAllEvents",
+         [](const std::string& input) {
+             SOCO::EventReader reader;
+             reader.mapFile(input);
+             sink = reader.readAllEvents().size();
+         }},
+        {std::string("readBatch (") + SOCO::deinterleaveHitsKernel() + ")",
+         [](const std::string& input) {
+             SOCO::EventReader reader;
+             reader.mapFile(input);
+             SOCO::EventBatch batch;
+             uint64_t sum = 0;
+             while (reader.readBatch(batch, 4096))
+             {
+                 sum += batch.hits;
+             }
+             sink = sum;
+         }},
+        {std::string("readBatch + calibrate (") + SOCO::calibrationKernel() + ")",
+         [](const std::string& input) {
+             // quadratic calibration of every id
+             SOCO::Calibration calibration;
+             for (size_t id = 0; id < SOCO::Calibration::IDS; ++id)
+             {
+                 calibration.set(static_cast<uint16_t>(id), {0.5, 0.8, 1e-7});
+             }
+             SOCO::EventReader reader;
+             reader.mapFile(input);
+             SOCO::EventBatch batch;
+             double sum = 0;
+             while (reader.readBatch(batch, 4096))
+             {
+                 calibration.apply(batch);
+                 sum += batch.energies[0];
+             }
+             sink = static_cast<uint64_t>(sum);
+         }},
+        {"EventBuilder rebuild",
+         [](const std::string& input) {
+             SOCO::EventReader reader;
+             reader.mapFile(input);
+             SOCO::EventBuilder builder(
+                 [&reader](SOCO::EventBatch& batch, size_t n) { return reader.readBatch(batch, n); }, 500);
+             SOCO::EventBatch batch;
+             uint64_t sum = 0;
+             while (builder.readBatch(batch, 4096))
+             {
+                 sum += batch.events;
+             }
+             sink = sum;
+         }},
+        {"Soco2Root::process event",
+         [convert](const std::string& input) { convert(input, OutputLayout::Event, false); }},
+        {"Soco2Root::process flat",
+         [convert](const std::string& input) { convert(input, OutputLayout::Flat, false); }},
+        {"Soco2Root::process relative",
+         [convert](const std::string& input) { convert(input, OutputLayout::Relative, false); }},
+        {"Soco2Root::process event pipelined",
+         [convert](const std::string& input) { convert(input, OutputLayout::Event, true); }},
+        {"Soco2Root::process flat pipelined",
+         [convert](const std::string& input) { convert(input, OutputLayout::Flat, true); }},
+    };
+}
+
+} // namespace {anonymous}
+
+int main(int ac, char* av[])
+{
+    try
+    {
+        po::options_description desc("soco-bench");
+        // clang-format off
+        desc.add_options()
+            ("help,h", "Display this help message")
+            ("repeat,r", po::value<int>()->default_value(3), "Number of runs per benchmark, the fastest is reported")
+            ("filter,f", po::value<std::string>()->default_value(""), "Only run benchmarks whose name contains this string")
+            ("output-dir,o", po::value<std::string>()->default_value("/tmp"), "Directory for temporary ROOT files")
+            ("read-buffer", po::value<size_t>()->default_value(64), "Ring buffer size in MiB for the stream benchmark")
+            ("input-files", po::value<std::vector<std::string>>()->required(), "Input files");
+        // clang-format on
+
+        po::positional_options_description p;
+        p.add("input-files", -1);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(ac, av).options(desc).positional(p).run(), vm);
+        if (vm.count("help"))
+        {
+            std::cout << desc;
+            return 0;
+        }
+        po::notify(vm);
+
+        const int repeat         = std::max(1, vm["repeat"].as<int>());
+        const std::string filter = vm["filter"].as<std::string>();
+        const auto tests         = benchmarks(vm["output-dir"].as<std::string>(), vm["read-buffer"].as<size_t>() << 20);
+
+        for (const std::string& input : vm["input-files"].as<std::vector<std::string>>())
+        {
+            struct stat sb;
+            SOCO::FSUtils::stat(input, &sb);
+            const double megabytes = sb.st_size / 1e6;
+
+            SOCO::EventReader reader;
+            reader.mapFile(input);
+            const double events = reader.buildIndex().numberOfEvents();
+
+            std::cout << input << " (" << std::fixed << std::setprecision(1) << megabytes << " MB, "
+                      << std::setprecision(0) << events << " events)\n";
+            std::cout << std::left << std::setw(36) << "benchmark" << std::right << std::setw(12) << "time [s]"
+                      << std::setw(16) << "events/s" << std::setw(12) << "MB/s" << std::endl;
+
+            for (const auto& test : tests)
+            {
+                if (test.name.find(filter) == std::string::npos)
+                {
+                    continue;
+                }
+
+                double best = 0;
+                for (int i = 0; i < repeat; ++i)
+                {
+                    const auto start = std::chrono::steady_clock::now();
+                    test.run(input);
+                    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                    best = (i == 0) ? elapsed.count() : std::min(best, elapsed.count());
+                }
+
+                std::cout << std::left << std::setw(36) << test.name << std::right << std::setprecision(3)
+                          << std::setw(12) << best << std::setprecision(0) << std::setw(16) << events / best
+                          << std::setprecision(1) << std::setw(12) << megabytes / best << std::endl;
+            }
+            std::cout << std::endl;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
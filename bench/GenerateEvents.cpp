@@ -0,0 +1,264 @@
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Deterministic generator for synthetic soco2 event files
+// The same options always produce the same file, independent of platform and standard library.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include "Event.h"
+
+namespace
+{
+
+// mt19937_64 output is fully specified by the standard, the std distributions are not
+class Random
+{
+    public:
+    explicit Random(uint64_t seed)
+        : engine(seed)
+    {
+    }
+
+    double uniform() { return (engine() >> 11) * (1.0 / 9007199254740992.0); }
+
+    uint64_t uniform(uint64_t n) { return n ? engine() % n : 0; }
+
+    // Knuth's algorithm, fine for small means
+    uint64_t poisson(double mean)
+    {
+        const double limit = std::exp(-mean);
+        uint64_t k         = 0;
+        double p           = uniform();
+        while (p > limit)
+        {
+            ++k;
+            p *= uniform();
+        }
+        return k;
+    }
+
+    private:
+    std::mt19937_64 engine;
+};
+
+// Multiplicity distribution: "fixed:N", "uniform:MIN:MAX" or "poisson:MEAN"
+class Multiplicity
+{
+    public:
+    explicit Multiplicity(const std::string& spec)
+    {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        for (size_t pos = spec.find(':'); pos != std::string::npos; pos = spec.find(':', start))
+        {
+            parts.push_back(spec.substr(start, pos - start));
+            start = pos + 1;
+        }
+        parts.push_back(spec.substr(start));
+
+        kind = parts[0];
+        if (kind == "fixed" && parts.size() == 2)
+        {
+            min = max = std::stoul(parts[1]);
+        }
+        else if (kind == "uniform" && parts.size() == 3)
+        {
+            min = std::stoul(parts[1]);
+            max = std::stoul(parts[2]);
+        }
+        else if (kind == "poisson" && parts.size() == 2)
+        {
+            mean = std::stod(parts[1]);
+            min  = 1;
+            max  = std::numeric_limits<uint8_t>::max();
+        }
+        else
+        {
+            throw std::runtime_error("Invalid multiplicity distribution '" + spec + "'");
+        }
+        if (min > max || max > std::numeric_limits<uint8_t>::max())
+        {
+            throw std::runtime_error("Invalid multiplicity range in '" + spec + "'");
+        }
+    }
+
+    size_t operator()(Random& rng) const
+    {
+        if (kind == "poisson")
+        {
+            // at least one hit, the trigger
+            return std::min<size_t>(max, 1 + rng.poisson(std::max(0.0, mean - 1)));
+        }
+        return min + rng.uniform(max - min + 1);
+    }
+
+    private:
+    std::string kind;
+    size_t min  = 1;
+    size_t max  = 1;
+    double mean = 1;
+};
+
+// Id set: comma separated ids and ranges, e.g. "14060,14062,14080-14083"
+std::vector<uint16_t> parseIds(const std::string& spec)
+{
+    std::vector<uint16_t> ids;
+    size_t start = 0;
+    while (start < spec.size())
+    {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = spec.size();
+        }
+        const std::string item = spec.substr(start, end - start);
+        const size_t dash      = item.find('-');
+        const unsigned long first = std::stoul(item.substr(0, dash));
+        const unsigned long last  = (dash == std::string::npos) ? first : std::stoul(item.substr(dash + 1));
+        if (first > last || last > std::numeric_limits<uint16_t>::max())
+        {
+            throw std::runtime_error("Invalid id range '" + item + "'");
+        }
+        for (unsigned long id = first; id <= last; ++id)
+        {
+            ids.push_back(static_cast<uint16_t>(id));
+        }
+        start = end + 1;
+    }
+    if (ids.empty())
+    {
+        throw std::runtime_error("No ids given");
+    }
+    return ids;
+}
+
+template <typename T>
+void put(std::vector<uint8_t>& buffer, const T& value)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+    buffer.insert(buffer.end(), p, p + sizeof(T));
+}
+
+} // namespace {anonymous}
+
+int main(int ac, char* av[])
+{
+    try
+    {
+        po::options_description desc("soco-gen");
+        // clang-format off
+        desc.add_options()
+            ("help,h", "Display this help message")
+            ("output,o", po::value<std::string>()->required(), "Output event file")
+            ("events,n", po::value<uint64_t>()->default_value(1000000), "Number of events")
+            ("multiplicity,m", po::value<std::string>()->default_value("poisson:2.5"), "Multiplicity distribution: 'fixed:N', 'uniform:MIN:MAX' or 'poisson:MEAN' (1 + Poisson(MEAN - 1))")
+            ("ids", po::value<std::string>()->default_value("14060,14062,14082,14100,14102,14103,14222,14230,14232,14260,14262,14263"), "Detector ids, comma separated ids and ranges (e.g. 100-131)")
+            ("metadata", po::value<size_t>()->default_value(2), "Number of metadata blocks")
+            ("metadata-size", po::value<size_t>()->default_value(256), "Size of each metadata block in bytes")
+            ("seed", po::value<uint64_t>()->default_value(42), "Random seed");
+        // clang-format on
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(ac, av, desc), vm);
+        if (vm.count("help"))
+        {
+            std::cout << desc;
+            return 0;
+        }
+        po::notify(vm);
+
+        const std::string output = vm["output"].as<std::string>();
+        const uint64_t events    = vm["events"].as<uint64_t>();
+        const Multiplicity multiplicity(vm["multiplicity"].as<std::string>());
+        const std::vector<uint16_t> ids = parseIds(vm["ids"].as<std::string>());
+        Random rng(vm["seed"].as<uint64_t>());
+
+        std::ofstream out(output, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            throw std::runtime_error("Can't open " + output);
+        }
+
+        std::vector<uint8_t> buffer;
+        put(buffer, SOCO::EventHeader{SOCO::SOCO_EVENT_MAGIC, events});
+        for (size_t i = 0; i < vm["metadata"].as<size_t>(); ++i)
+        {
+            const size_t size = vm["metadata-size"].as<size_t>();
+            put(buffer, SOCO::EventMetadataHeader{SOCO::SOCO_META_MAGIC, size});
+            std::string text = "Synthetic metadata block " + std::to_string(i) + "\n";
+            text.resize(size, '#');
+            buffer.insert(buffer.end(), text.begin(), text.end());
+        }
+        put(buffer, SOCO::SOCO_DATA_MAGIC);
+
+        // events are time ordered, hits are spread around the trigger
+        const size_t flush_size = 16 << 20;
+        uint64_t time           = 1000000;
+        for (uint64_t n = 0; n < events; ++n)
+        {
+            time += 100 + rng.uniform(5000);
+            const size_t mult      = multiplicity(rng);
+            const uint16_t trigger = ids[rng.uniform(ids.size())];
+
+            put(buffer, static_cast<uint8_t>(mult));
+            put(buffer, trigger);
+            for (size_t h = 0; h < mult; ++h)
+            {
+                const uint16_t id  = (h == 0) ? trigger : ids[rng.uniform(ids.size())];
+                const uint64_t ts  = (h == 0) ? time : time - 40 + rng.uniform(80);
+                const uint16_t adc = static_cast<uint16_t>(rng.uniform(16384));
+                put(buffer, id);
+                put(buffer, ts);
+                put(buffer, adc);
+            }
+
+            if (buffer.size() >= flush_size)
+            {
+                out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+                buffer.clear();
+            }
+        }
+        out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+        out.close();
+        if (!out)
+        {
+            throw std::runtime_error("Failed to write " + output);
+        }
+        std::cout << output << ": " << events << " events" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
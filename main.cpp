@@ -17,9 +17,17 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <chrono>
+#include <csignal>
 #include <exception>
+#include <fstream>
 #include <iostream>
 #include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -29,8 +37,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <boost/thread.hpp>
 namespace po = boost::program_options;
 
+#include "Calibration.h"
+#include "EventFilter.h"
+#include "EventReader.h"
 #include "FSUtils.h"
+#include "Manifest.h"
+#include "MergedOutput.h"
+#include "Scheduler.h"
 #include "Soco2Root.h"
+#include "Verify.h"
 
 using asio_service = boost::asio::io_service;
 using asio_worker  = std::unique_ptr<asio_service::work>;
@@ -66,6 +81,11 @@ struct ThreadPool
     boost::thread_group group;
 };
 
+extern "C" void stopFollowing(int)
+{
+    Soco2Root::stopFollowing();
+}
+
 std::string getOutputFilename(const std::string& input, const po::variables_map& vm)
 {
 
@@ -81,6 +101,35 @@ std::string getOutputFilename(const std::string& input, const po::variables_map&
     }
 }
 
+// Digest of everything that changes the output files, recorded in the manifest with --incremental
+// The filter options as given, the calibration by the contents of its file
+uint64_t optionsDigest(const Soco2RootOptions& options, const po::variables_map& vm)
+{
+    std::ostringstream text;
+    text << static_cast<int>(options.layout) << ' ' << static_cast<int>(options.split_triggers) << ' '
+         << options.compressionSettings() << ' ' << options.basket_size << ' ' << options.auto_flush << ' '
+         << options.first_event << ' ' << options.max_events << ' ' << options.id_index << ' '
+         << options.rebuild << ' ' << options.rebuild_window << ' ' << options.reorder_window;
+    for (const char* name : {"ids", "deny-ids", "triggers"})
+    {
+        text << ' ' << (vm.count(name) ? vm[name].as<std::string>() : "-");
+    }
+    for (const char* name : {"min-mult", "max-mult"})
+    {
+        text << ' ' << (vm.count(name) ? std::to_string(vm[name].as<size_t>()) : "-");
+    }
+    for (const char* name : {"adc-min", "adc-max"})
+    {
+        text << ' ' << (vm.count(name) ? std::to_string(vm[name].as<uint16_t>()) : "-");
+    }
+    if (vm.count("calibration"))
+    {
+        std::ifstream calibration(vm["calibration"].as<std::string>());
+        text << ' ' << calibration.rdbuf();
+    }
+    return ManifestEntry::digest(text.str());
+}
+
 int main(int ac, char* av[])
 {
     try
@@ -92,6 +141,44 @@ int main(int ac, char* av[])
             ("version,v", "Display the version number")
             ("threads,t", po::value<int>()->default_value(1), "Number of threads")
             ("output-dir,o", po::value<std::string>(), "Output directory. If not set, input file location is used")
+            ("chunks,c", po::value<int>()->default_value(1), "Number of chunks per file, converted in parallel and merged in order")
+            ("first-event", po::value<uint64_t>(), "Number of the first event to convert")
+            ("max-events", po::value<uint64_t>(), "Maximum number of events to convert")
+            ("build-index", "Only build the sparse event index of each input and save it next to the input file")
+            ("verify", "Only check the framing of each input: event count against the header, truncated events and multiplicities, one chunk per thread")
+            ("checksum", "With --verify, also compute a checksum of all events that does not depend on their order")
+            ("no-mmap", "Do not mmap input files, which is always the case on remote file systems")
+            ("read-buffer", po::value<size_t>(), "Stream files that are not mmap-ed through a ring buffer of this many MiB instead of reading them to memory completely")
+            ("layout,l", po::value<std::string>()->default_value("event"), "Output tree layout: 'event' (SOCO::Event branch), 'flat' (split arrays) or 'relative' (split arrays, hit timestamps relative to the event)")
+            ("split-triggers", po::value<std::string>()->default_value("none"), "Separate output for each trigger id: 'none', 'tree' (trees 'ttree_<id>') or 'file' (files '<name>.trg<id>.root')")
+            ("profile", po::value<std::string>(), "Compression preset: 'fast', 'balanced' or 'archive', can be refined by the following options")
+            ("compression", po::value<std::string>(), "Compression algorithm: 'zlib', 'lzma', 'lz4' or 'zstd'")
+            ("compression-level", po::value<int>(), "Compression level (1-9)")
+            ("basket-size", po::value<int>(), "Branch basket size in bytes")
+            ("auto-flush", po::value<int64_t>(), "TTree AutoFlush: entries if positive, bytes if negative")
+            ("pipeline", "Decode events on a second thread per file while the tree is filled")
+            ("merge-output", po::value<std::string>(), "Convert all input files into this single ROOT file, ordered by part number")
+            ("merge-buffers", po::value<size_t>(), "Maximum number of parts held in memory with --merge-output, at least the number of threads (default: 2 * threads)")
+            ("incremental", "Only convert files that changed since their last conversion, recorded in a manifest in the output directory")
+            ("follow", "Keep converting events appended to the input files until interrupted or the idle timeout")
+            ("poll-interval", po::value<int>()->default_value(1000), "Interval in ms to check for new data with --follow")
+            ("idle-timeout", po::value<double>()->default_value(0), "Stop following a file after this many seconds without new data, 0: never")
+            ("autosave", po::value<double>()->default_value(10), "Save the tree every this many seconds with --follow")
+            ("time-ordered", po::value<std::string>(), "Merge the events of all input files, each sorted by time, into this time-ordered ROOT file")
+            ("rebuild-window", po::value<uint64_t>(), "Rebuild the events of time-ordered input files from their hits with this coincidence window (in units of the timestamps)")
+            ("reorder-window", po::value<uint64_t>(), "Hits of later events may be this much earlier than the latest hit with --rebuild-window (default: twice the longest input event)")
+            ("min-mult", po::value<size_t>(), "Only convert events with at least this many hits, counted after the id and ADC selection (default: 1 if any selection is set)")
+            ("max-mult", po::value<size_t>(), "Only convert events with at most this many hits, counted after the id and ADC selection")
+            ("ids", po::value<std::string>(), "Only convert hits of these detector ids, e.g. '0-15,20'")
+            ("deny-ids", po::value<std::string>(), "Drop hits of these detector ids, e.g. '3,7'")
+            ("triggers", po::value<std::string>(), "Only convert events with these trigger ids, e.g. '0,1'")
+            ("adc-min", po::value<uint16_t>(), "Drop hits with a smaller ADC value")
+            ("adc-max", po::value<uint16_t>(), "Drop hits with a larger ADC value")
+            ("calibration", po::value<std::string>(), "Write the energy of each hit, calibrated with the polynomials in this file (lines 'id c0 c1 ...')")
+            ("id-index", "Write hit_idx, the index of the id of each hit in the sorted ids of the input files")
+            ("stats-json", po::value<std::string>(), "Write timings and throughput of all files to this JSON file")
+            ("schedule", po::value<std::string>()->default_value("lpt"), "Order of files for multiple threads: 'lpt' (largest first) or 'fifo' (command line order)")
+            ("work-stealing", "Assign files to threads up front, idle threads take files from the busiest thread")
             ("input-files", po::value<std::vector<std::string>>(), "Input files");
         // clang-format on
 
@@ -115,30 +202,301 @@ int main(int ac, char* av[])
 
         if (vm.count("input-files"))
         {
-            const std::vector<std::string> files = vm["input-files"].as<std::vector<std::string>>();
+            std::vector<std::string> files = vm["input-files"].as<std::vector<std::string>>();
             const int threads                    = vm["threads"].as<int>();
 
-            if (threads > 1)
+            Soco2RootOptions options;
+            options.layout         = parseOutputLayout(vm["layout"].as<std::string>());
+            options.split_triggers = parseTriggerSplit(vm["split-triggers"].as<std::string>());
+            options.chunks         = vm["chunks"].as<int>();
+            if (vm.count("first-event"))
             {
-                std::cout << "Using thread pool with " << threads << " threads." << std::endl;
-                ThreadPool pool(threads);
+                options.first_event = vm["first-event"].as<uint64_t>();
+            }
+            if (vm.count("max-events"))
+            {
+                options.max_events = vm["max-events"].as<uint64_t>();
+            }
+
+            if (vm.count("profile"))
+            {
+                applyProfile(options, vm["profile"].as<std::string>());
+            }
+            if (vm.count("compression"))
+            {
+                options.compression = parseCompressionAlgorithm(vm["compression"].as<std::string>());
+            }
+            if (vm.count("compression-level"))
+            {
+                options.compression_level = vm["compression-level"].as<int>();
+            }
+            if (vm.count("basket-size"))
+            {
+                options.basket_size = vm["basket-size"].as<int>();
+            }
+            if (vm.count("auto-flush"))
+            {
+                options.auto_flush = vm["auto-flush"].as<int64_t>();
+            }
+
+            options.pipeline = vm.count("pipeline") > 0;
+            if (vm.count("follow"))
+            {
+                options.follow           = true;
+                options.poll_interval_ms = vm["poll-interval"].as<int>();
+                options.idle_timeout     = vm["idle-timeout"].as<double>();
+                options.autosave_seconds = vm["autosave"].as<double>();
+                // finish the output files cleanly on Ctrl-C
+                std::signal(SIGINT, stopFollowing);
+                std::signal(SIGTERM, stopFollowing);
+            }
+            if (vm.count("min-mult") || vm.count("max-mult") || vm.count("ids") || vm.count("deny-ids") ||
+                vm.count("triggers") || vm.count("adc-min") || vm.count("adc-max"))
+            {
+                std::shared_ptr<SOCO::EventFilter> filter(new SOCO::EventFilter());
+                filter->setMultiplicity(vm.count("min-mult") ? vm["min-mult"].as<size_t>() : 1,
+                                        vm.count("max-mult") ? vm["max-mult"].as<size_t>() : 255);
+                filter->setAdcWindow(vm.count("adc-min") ? vm["adc-min"].as<uint16_t>() : 0,
+                                     vm.count("adc-max") ? vm["adc-max"].as<uint16_t>() : 65535);
+                if (vm.count("ids"))
+                {
+                    filter->allowIds(SOCO::EventFilter::parseIdList(vm["ids"].as<std::string>()));
+                }
+                if (vm.count("deny-ids"))
+                {
+                    filter->denyIds(SOCO::EventFilter::parseIdList(vm["deny-ids"].as<std::string>()));
+                }
+                if (vm.count("triggers"))
+                {
+                    filter->selectTriggers(SOCO::EventFilter::parseIdList(vm["triggers"].as<std::string>()));
+                }
+                options.filter = filter;
+            }
+            if (vm.count("calibration"))
+            {
+                options.calibration = std::make_shared<SOCO::Calibration>(vm["calibration"].as<std::string>());
+            }
+            options.id_index = vm.count("id-index") > 0;
+            if (vm.count("rebuild-window"))
+            {
+                options.rebuild        = true;
+                options.rebuild_window = vm["rebuild-window"].as<uint64_t>();
+            }
+            if (vm.count("reorder-window"))
+            {
+                if (!options.rebuild)
+                {
+                    throw std::runtime_error("--reorder-window needs --rebuild-window");
+                }
+                options.reorder_window = vm["reorder-window"].as<uint64_t>();
+            }
+            options.use_mmap = !vm.count("no-mmap");
+            if (vm.count("read-buffer"))
+            {
+                options.stream_memory = vm["read-buffer"].as<size_t>() << 20;
+            }
+
+            if (vm.count("build-index"))
+            {
+                for (const std::string& input : files)
+                {
+                    SOCO::EventReader reader;
+                    reader.mapFile(input, options.use_mmap, options.stream_memory);
+                    const auto& index = reader.buildIndex();
+                    reader.saveIndex();
+                    std::cout << input << ": " << index.numberOfEvents() << " events -> "
+                              << SOCO::EventIndex::sidecarFilename(input) << std::endl;
+                }
+                return 0;
+            }
+
+            if (vm.count("verify"))
+            {
+                // only reads the event files, no ROOT objects are created
+                bool ok = true;
+                for (const std::string& input : files)
+                {
+                    const auto start = std::chrono::steady_clock::now();
+                    SOCO::EventReader reader;
+                    reader.mapFile(input, options.use_mmap, options.stream_memory);
+                    const SOCO::VerifyResult result = SOCO::verify(reader, threads, vm.count("checksum") > 0);
+                    const double seconds = secondsSince(start);
+                    std::cout << input << ": " << result.summary() << "\n  " << reader.mappedBytes() / 1e6
+                              << " MB in " << seconds << " s ("
+                              << (seconds > 0 ? reader.mappedBytes() / 1e6 / seconds : 0) << " MB/s)" << std::endl;
+                    ok = ok && result.ok();
+                }
+                return ok ? 0 : 1;
+            }
+            if (vm.count("checksum"))
+            {
+                throw std::runtime_error("--checksum needs --verify");
+            }
+
+            if (options.split_triggers == TriggerSplit::File && (vm.count("merge-output") || vm.count("incremental")))
+            {
+                throw std::runtime_error("--split-triggers file can't be combined with --merge-output or --incremental");
+            }
+            if (vm.count("time-ordered") && (vm.count("merge-output") || vm.count("incremental")))
+            {
+                throw std::runtime_error("--time-ordered can't be combined with --merge-output or --incremental");
+            }
+
+            // --incremental: skip files that are unchanged since their last conversion
+            // one manifest per output directory
+            std::map<std::string, std::unique_ptr<Manifest>> manifests;
+            std::vector<ManifestEntry> entries;
+            std::vector<Manifest*> file_manifests;
+            if (vm.count("incremental"))
+            {
+                if (vm.count("merge-output"))
+                {
+                    throw std::runtime_error("--incremental can't be combined with --merge-output");
+                }
+                const uint64_t digest = optionsDigest(options, vm);
+                std::vector<std::string> changed;
                 for (const std::string& input : files)
                 {
-                    pool.enqueue([=]() {
-                        Soco2Root s2r(input, getOutputFilename(input, vm));
-                        s2r.process();
-                    });
+                    const std::string output = getOutputFilename(input, vm);
+                    const std::string dir    = SOCO::FSUtils::dirname(output);
+                    auto& manifest           = manifests[dir];
+                    if (!manifest)
+                    {
+                        manifest.reset(new Manifest(Manifest::filenameFor(dir)));
+                    }
+
+                    const ManifestEntry entry = ManifestEntry::describe(input, output, digest);
+                    const std::string reason  = manifest->needsConversion(entry);
+                    if (reason.empty())
+                    {
+                        std::cout << input << ": up to date, skipped" << std::endl;
+                        continue;
+                    }
+                    std::cout << input << ": " << reason << ", converting" << std::endl;
+                    changed.push_back(input);
+                    entries.push_back(entry);
+                    file_manifests.push_back(manifest.get());
                 }
+                files.swap(changed);
+            }
+
+            // one entry per file, each written by one thread only
+            std::vector<ConversionStats> stats(files.size());
+            auto convert = [&](const size_t i) {
+                Soco2Root s2r(files[i], getOutputFilename(files[i], vm), options);
+                s2r.process();
+                stats[i] = s2r.getStats();
+                if (!file_manifests.empty())
+                {
+                    file_manifests[i]->update(entries[i]);
+                }
+            };
+
+            // files that were not converted with --threads, the others are converted nevertheless
+            size_t failed    = 0;
+            const auto start = std::chrono::steady_clock::now();
+            if (vm.count("time-ordered"))
+            {
+                Soco2Root s2r(files, vm["time-ordered"].as<std::string>(), options);
+                s2r.process();
+                stats.assign(1, s2r.getStats());
+            }
+            else if (vm.count("merge-output"))
+            {
+                const size_t buffered = vm.count("merge-buffers") ? vm["merge-buffers"].as<size_t>() : 2 * threads;
+                MergedOutput merged(vm["merge-output"].as<std::string>(), options, threads, buffered);
+                merged.process(files);
+                stats = merged.getStats();
+            }
+            else if (threads > 1)
+            {
+                Scheduler scheduler(files,
+                                    static_cast<size_t>(threads),
+                                    parseSchedulePolicy(vm["schedule"].as<std::string>()),
+                                    vm.count("work-stealing") > 0);
+                std::cout << "Using thread pool with " << threads << " threads." << std::endl;
+                // the threads are shared by the files converted at the same time and their chunks
+                const size_t parallel = std::max<size_t>(std::min(scheduler.threads(), files.size()), 1);
+                const int chunks      = std::max(threads / static_cast<int>(parallel), 1);
+                if (options.chunks > chunks)
+                {
+                    std::cout << "[W] " << threads << " threads for " << parallel << " file(s) at once, using "
+                              << chunks << " instead of " << options.chunks << " chunks per file" << std::endl;
+                    options.chunks = chunks;
+                }
+                std::cout << "Expected makespan: " << scheduler.expectedMakespan() / 1e6
+                          << " MB on the busiest thread, " << scheduler.totalBytes() / 1e6 / threads
+                          << " MB with perfect balance" << std::endl;
+
+                std::vector<double> busy(scheduler.threads(), 0.);
+                std::mutex failed_mutex;
+                failed = scheduler.skipped().size();
+                {
+                    ThreadPool pool(scheduler.threads());
+                    for (size_t w = 0; w < scheduler.threads(); ++w)
+                    {
+                        pool.enqueue([&, w]() {
+                            const auto worker_start = std::chrono::steady_clock::now();
+                            size_t i;
+                            while (scheduler.next(w, i))
+                            {
+                                try
+                                {
+                                    convert(i);
+                                }
+                                catch (const std::exception& e)
+                                {
+                                    std::lock_guard<std::mutex> lock(failed_mutex);
+                                    std::cerr << "Error: " << files[i] << ": " << e.what() << std::endl;
+                                    ++failed;
+                                }
+                            }
+                            busy[w] = secondsSince(worker_start);
+                        });
+                    }
+                }
+
+                // convert the expected makespan to seconds with the measured speed of a single thread
+                double bytes = 0, seconds = 0;
+                for (const auto& s : stats)
+                {
+                    bytes += s.input_bytes;
+                    seconds += s.total_seconds;
+                }
+                const double expected = (bytes > 0) ? scheduler.expectedMakespan() * seconds / bytes : 0;
+                std::cout << "Makespan: " << secondsSince(start) << " s, expected " << expected
+                          << " s, threads busy between " << *std::min_element(busy.begin(), busy.end())
+                          << " s and " << *std::max_element(busy.begin(), busy.end()) << " s" << std::endl;
             }
             else
             {
                 std::cout << "No multithreading." << std::endl;
-                for (const std::string& input : files)
+                for (size_t i = 0; i < files.size(); ++i)
                 {
-                    Soco2Root s2r(input, getOutputFilename(input, vm));
-                    s2r.process();
+                    convert(i);
                 }
             }
+            const double wall_seconds = secondsSince(start);
+
+            ConversionStats total;
+            for (const auto& s : stats)
+            {
+                total += s;
+            }
+            total.input         = "Total";
+            total.total_seconds = wall_seconds;
+            std::cout << total.summary() << std::endl;
+
+            if (vm.count("stats-json"))
+            {
+                writeStatsJson(vm["stats-json"].as<std::string>(), stats, wall_seconds, threads);
+            }
+            if (failed)
+            {
+                std::cerr << "Error: " << failed << " of " << files.size() << " files were not converted"
+                          << std::endl;
+                return 1;
+            }
         }
         else
         {
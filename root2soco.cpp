@@ -0,0 +1,205 @@
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Converts trees written by soco2root (event, flat or relative layout) back to soco2 event files
+
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include "Event.h"
+#include "EventReader.h"
+#include "EventWriter.h"
+#include "FSUtils.h"
+#include "RelativeTimestamps.h"
+
+namespace
+{
+
+std::string getOutputFilename(const std::string& input, const po::variables_map& vm)
+{
+    if (vm.count("output-dir"))
+    {
+        return SOCO::FSUtils::buildFilename(SOCO::FSUtils::basename(input),
+                                            vm["output-dir"].as<std::string>(),
+                                            ".root2soco.evt");
+    }
+    else
+    {
+        // not <name>.evt, that is usually the original file of the tree
+        return SOCO::FSUtils::stripExtension(input) + ".root2soco.evt";
+    }
+}
+
+void convertEventLayout(TTree& ttree, SOCO::EventWriter& writer)
+{
+    SOCO::Event* event = nullptr;
+    ttree.SetBranchAddress("events", &event);
+    const Long64_t entries = ttree.GetEntries();
+    for (Long64_t i = 0; i < entries; ++i)
+    {
+        ttree.GetEntry(i);
+        writer.write(*event);
+    }
+    ttree.ResetBranchAddresses();
+    delete event;
+}
+
+// Flat or relative layout
+void convertFlatLayout(TTree& ttree, SOCO::EventWriter& writer)
+{
+    constexpr size_t MAX_MULTIPLICITY = std::numeric_limits<uint8_t>::max();
+    UShort_t trigger_id;
+    ULong64_t timestamp;
+    UInt_t mult;
+    UShort_t hit_id[MAX_MULTIPLICITY];
+    UShort_t hit_adc[MAX_MULTIPLICITY];
+    ULong64_t hit_ts[MAX_MULTIPLICITY];
+    Int_t hit_dt[MAX_MULTIPLICITY];
+    ULong64_t hit_ts_escaped[MAX_MULTIPLICITY];
+    const bool relative = ttree.GetBranch("hit_dt") != nullptr;
+    ttree.SetBranchAddress("trigger_id", &trigger_id);
+    ttree.SetBranchAddress("mult", &mult);
+    ttree.SetBranchAddress("hit_id", hit_id);
+    ttree.SetBranchAddress("hit_adc", hit_adc);
+    if (relative)
+    {
+        ttree.SetBranchAddress("timestamp", &timestamp);
+        ttree.SetBranchAddress("hit_dt", hit_dt);
+        ttree.SetBranchAddress("hit_ts_escaped", hit_ts_escaped);
+    }
+    else
+    {
+        ttree.SetBranchAddress("hit_ts", hit_ts);
+    }
+
+    SOCO::Event event;
+    const Long64_t entries = ttree.GetEntries();
+    for (Long64_t i = 0; i < entries; ++i)
+    {
+        ttree.GetEntry(i);
+        if (relative)
+        {
+            SOCO::decodeTimestamps(timestamp, hit_dt, mult, hit_ts_escaped, hit_ts);
+        }
+        event.clear();
+        event.trigger_id = trigger_id;
+        for (UInt_t h = 0; h < mult; ++h)
+        {
+            event.hits.emplace_back(hit_id[h], hit_adc[h], hit_ts[h]);
+        }
+        writer.write(event);
+    }
+    ttree.ResetBranchAddresses();
+}
+
+} // namespace {anonymous}
+
+int main(int ac, char* av[])
+{
+    try
+    {
+        po::options_description desc("root2soco");
+        // clang-format off
+        desc.add_options()
+            ("help,h", "Display this help message")
+            ("output-dir,o", po::value<std::string>(), "Output directory. If not set, input file location is used")
+            ("tree", po::value<std::string>()->default_value("ttree"), "Name of the tree")
+            ("metadata-from", po::value<std::string>(), "Copy the metadata blocks of this event file")
+            ("force", "Overwrite existing output files")
+            ("input-files", po::value<std::vector<std::string>>(), "Input files");
+        // clang-format on
+
+        po::positional_options_description p;
+        p.add("input-files", -1);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(ac, av).options(desc).positional(p).run(), vm);
+        po::notify(vm);
+
+        if (vm.count("help"))
+        {
+            std::cout << desc;
+            return 0;
+        }
+        if (!vm.count("input-files"))
+        {
+            throw std::runtime_error("Not Input files!");
+        }
+
+        std::vector<std::string> metadata;
+        if (vm.count("metadata-from"))
+        {
+            SOCO::EventReader reader;
+            reader.mapFile(vm["metadata-from"].as<std::string>());
+            for (size_t i = 0; i < reader.metadataSize(); ++i)
+            {
+                metadata.push_back(reader[i]);
+            }
+        }
+
+        const std::string tree_name = vm["tree"].as<std::string>();
+        for (const std::string& input : vm["input-files"].as<std::vector<std::string>>())
+        {
+            const std::string output = getOutputFilename(input, vm);
+            std::cout << input << " -> " << output << std::endl;
+
+            std::unique_ptr<TFile> tfile(TFile::Open(input.c_str(), "READ"));
+            if (!tfile || tfile->IsZombie())
+            {
+                throw std::runtime_error("Can't open " + input);
+            }
+            TTree* ttree = nullptr;
+            tfile->GetObject(tree_name.c_str(), ttree);
+            if (!ttree)
+            {
+                throw std::runtime_error(input + " does not contain a tree " + tree_name);
+            }
+
+            std::vector<std::string> blocks = metadata;
+            blocks.push_back("Generated by root2soco from: " + input + "\n");
+            SOCO::EventWriter writer(
+                output, blocks, SOCO::EventWriter::DEFAULT_BUFFER_SIZE, vm.count("force") > 0);
+            if (ttree->GetBranch("events"))
+            {
+                convertEventLayout(*ttree, writer);
+            }
+            else
+            {
+                convertFlatLayout(*ttree, writer);
+            }
+            writer.close();
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
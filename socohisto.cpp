@@ -0,0 +1,361 @@
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Builds raw or calibrated spectra of every detector id and a symmetric gamma-gamma matrix
+// directly from soco2 event files, without converting them to trees first
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include "TFile.h"
+#include "TH1.h"
+#include "TH2.h"
+
+#include "Calibration.h"
+#include "EventFilter.h"
+#include "EventReader.h"
+
+namespace
+{
+
+constexpr size_t MAX_MULTIPLICITY = std::numeric_limits<uint8_t>::max();
+
+// Number of events decoded at once, see SOCO::EventReader::readBatchAt
+constexpr size_t BATCH_SIZE = 4096;
+
+// Equal width bins in [min, max), same bin numbers as TH1::FindBin: 0 underflow, bins + 1 overflow
+struct Binning
+{
+    size_t bins;
+    double min;
+    double max;
+
+    size_t find(const double x) const
+    {
+        if (!(x >= min))
+        {
+            return 0;
+        }
+        if (x >= max)
+        {
+            return bins + 1;
+        }
+        return 1 + static_cast<size_t>(bins * (x - min) / (max - min));
+    }
+};
+
+// Counts of one thread, merged into histograms at the end
+// The matrix only counts each pair of hits once, in the upper triangle, see Histograms::write.
+class Histograms
+{
+    public:
+    Histograms(const Binning& spectrum, const Binning& matrix, const bool with_matrix)
+        : spectrum_(spectrum)
+        , matrix_binning_(matrix)
+        , spectra_(SOCO::Calibration::IDS)
+        , matrix_(with_matrix ? (matrix.bins + 2) * (matrix.bins + 2) : 0, 0)
+    {
+    }
+
+    void fill(const SOCO::EventBatch& batch, const bool calibrated)
+    {
+        size_t bins[MAX_MULTIPLICITY];
+        for (size_t i = 0; i < batch.events; ++i)
+        {
+            const size_t first = batch.offsets[i];
+            const size_t mult  = batch.multiplicity(i);
+            for (size_t h = 0; h < mult; ++h)
+            {
+                const double value = calibrated ? batch.energies[first + h] : batch.adcs[first + h];
+                spectrum(batch.ids[first + h])[spectrum_.find(value)]++;
+                bins[h] = matrix_binning_.find(value);
+            }
+            if (matrix_.empty())
+            {
+                continue;
+            }
+            const size_t stride = matrix_binning_.bins + 2;
+            for (size_t a = 0; a < mult; ++a)
+            {
+                for (size_t b = a + 1; b < mult; ++b)
+                {
+                    matrix_[std::min(bins[a], bins[b]) * stride + std::max(bins[a], bins[b])]++;
+                }
+            }
+        }
+    }
+
+    // Merges the counts of all threads and writes one TH1D per id and the symmetric TH2D "matrix"
+    static void write(const std::vector<std::unique_ptr<Histograms>>& threads, TFile& tfile)
+    {
+        const Histograms& first = *threads.front();
+        for (size_t id = 0; id < SOCO::Calibration::IDS; ++id)
+        {
+            std::vector<uint64_t> counts(first.spectrum_.bins + 2, 0);
+            bool found = false;
+            for (const auto& thread : threads)
+            {
+                const std::vector<uint64_t>& spectrum = thread->spectra_[id];
+                for (size_t bin = 0; bin < spectrum.size(); ++bin)
+                {
+                    counts[bin] += spectrum[bin];
+                }
+                found = found || !spectrum.empty();
+            }
+            if (!found)
+            {
+                continue;
+            }
+            const std::string name = std::to_string(id);
+            const Binning& binning = first.spectrum_;
+            TH1D hist(name.c_str(), name.c_str(), binning.bins, binning.min, binning.max);
+            double entries = 0;
+            for (size_t bin = 0; bin < counts.size(); ++bin)
+            {
+                hist.SetBinContent(bin, counts[bin]);
+                entries += counts[bin];
+            }
+            hist.SetEntries(entries);
+            tfile.WriteTObject(&hist);
+        }
+
+        if (first.matrix_.empty())
+        {
+            return;
+        }
+        const Binning& binning = first.matrix_binning_;
+        const size_t stride    = binning.bins + 2;
+        TH2D matrix("matrix",
+                    "Gamma-Gamma Matrix",
+                    binning.bins,
+                    binning.min,
+                    binning.max,
+                    binning.bins,
+                    binning.min,
+                    binning.max);
+        double entries = 0;
+        for (size_t x = 0; x < stride; ++x)
+        {
+            for (size_t y = x; y < stride; ++y)
+            {
+                uint64_t count = 0;
+                for (const auto& thread : threads)
+                {
+                    count += thread->matrix_[x * stride + y];
+                }
+                // every pair is filled as (a, b) and (b, a)
+                if (x == y)
+                {
+                    matrix.SetBinContent(x, x, 2 * count);
+                }
+                else
+                {
+                    matrix.SetBinContent(x, y, count);
+                    matrix.SetBinContent(y, x, count);
+                }
+                entries += 2 * count;
+            }
+        }
+        matrix.SetEntries(entries);
+        tfile.WriteTObject(&matrix);
+    }
+
+    private:
+    std::vector<uint64_t>& spectrum(const uint16_t id)
+    {
+        std::vector<uint64_t>& s = spectra_[id];
+        if (s.empty())
+        {
+            s.resize(spectrum_.bins + 2, 0);
+        }
+        return s;
+    }
+
+    Binning spectrum_;
+    Binning matrix_binning_;
+    // indexed by id, empty for ids without hits
+    std::vector<std::vector<uint64_t>> spectra_;
+    std::vector<uint32_t> matrix_;
+};
+
+} // namespace {anonymous}
+
+int main(int ac, char* av[])
+{
+    try
+    {
+        po::options_description desc("soco-histo");
+        // clang-format off
+        desc.add_options()
+            ("help,h", "Display this help message")
+            ("output,o", po::value<std::string>()->default_value("histo.root"), "Output ROOT file")
+            ("threads,t", po::value<int>(), "Number of threads (default: number of cores)")
+            ("calibration", po::value<std::string>(), "Histogram energies calibrated with the polynomials in this file (lines 'id c0 c1 ...') instead of ADC values")
+            ("bins", po::value<size_t>()->default_value(16384), "Number of bins of the spectra")
+            ("min", po::value<double>()->default_value(0), "Lower edge of the spectra")
+            ("max", po::value<double>()->default_value(16384), "Upper edge of the spectra")
+            ("matrix-bins", po::value<size_t>()->default_value(2048), "Number of bins of the matrix on each axis, 0: no matrix")
+            ("matrix-min", po::value<double>(), "Lower edge of the matrix (default: --min)")
+            ("matrix-max", po::value<double>(), "Upper edge of the matrix (default: --max)")
+            ("ids", po::value<std::string>(), "Only use hits of these detector ids, e.g. '0-15,20'")
+            ("triggers", po::value<std::string>(), "Only use events with these trigger ids, e.g. '0,1'")
+            ("input-files", po::value<std::vector<std::string>>(), "Input files");
+        // clang-format on
+
+        po::positional_options_description p;
+        p.add("input-files", -1);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(ac, av).options(desc).positional(p).run(), vm);
+        po::notify(vm);
+
+        if (vm.count("help"))
+        {
+            std::cout << desc;
+            return 0;
+        }
+        if (!vm.count("input-files"))
+        {
+            throw std::runtime_error("Not Input files!");
+        }
+
+        const Binning spectrum{vm["bins"].as<size_t>(), vm["min"].as<double>(), vm["max"].as<double>()};
+        const Binning matrix{vm["matrix-bins"].as<size_t>(),
+                             vm.count("matrix-min") ? vm["matrix-min"].as<double>() : spectrum.min,
+                             vm.count("matrix-max") ? vm["matrix-max"].as<double>() : spectrum.max};
+        if (spectrum.bins == 0 || !(spectrum.min < spectrum.max) || !(matrix.min < matrix.max))
+        {
+            throw std::runtime_error("Invalid binning, need at least one bin and min < max");
+        }
+        const bool with_matrix = matrix.bins > 0;
+        const int cores        = static_cast<int>(std::thread::hardware_concurrency());
+        const int wanted       = vm.count("threads") ? vm["threads"].as<int>() : cores;
+        const size_t threads   = static_cast<size_t>(std::max(wanted, 1));
+
+        std::unique_ptr<SOCO::Calibration> calibration;
+        if (vm.count("calibration"))
+        {
+            calibration.reset(new SOCO::Calibration(vm["calibration"].as<std::string>()));
+        }
+        std::shared_ptr<SOCO::EventFilter> filter(new SOCO::EventFilter());
+        if (vm.count("ids"))
+        {
+            filter->allowIds(SOCO::EventFilter::parseIdList(vm["ids"].as<std::string>()));
+        }
+        if (vm.count("triggers"))
+        {
+            filter->selectTriggers(SOCO::EventFilter::parseIdList(vm["triggers"].as<std::string>()));
+        }
+
+        std::vector<std::unique_ptr<Histograms>> histograms;
+        for (size_t i = 0; i < threads; ++i)
+        {
+            histograms.emplace_back(new Histograms(spectrum, matrix, with_matrix));
+        }
+
+        // The events of each file are split into one chunk per thread
+        const auto start = std::chrono::steady_clock::now();
+        uint64_t events  = 0;
+        uint64_t hits    = 0;
+        for (const std::string& input : vm["input-files"].as<std::vector<std::string>>())
+        {
+            SOCO::EventReader reader;
+            reader.mapFile(input);
+            reader.setFilter(filter);
+            const auto chunks = reader.splitIntoChunks(threads);
+
+            std::vector<uint64_t> chunk_events(chunks.size(), 0);
+            std::vector<uint64_t> chunk_hits(chunks.size(), 0);
+            std::vector<std::exception_ptr> errors(chunks.size());
+            std::vector<std::thread> workers;
+            for (size_t i = 0; i < chunks.size(); ++i)
+            {
+                workers.emplace_back([&, i]() {
+                    try
+                    {
+                        SOCO::EventBatch batch;
+                        size_t pos = chunks[i].begin;
+                        while (reader.readBatchAt(batch, BATCH_SIZE, pos, chunks[i].end))
+                        {
+                            if (calibration)
+                            {
+                                calibration->apply(batch);
+                            }
+                            histograms[i]->fill(batch, calibration != nullptr);
+                            chunk_events[i] += batch.events;
+                            chunk_hits[i] += batch.hits;
+                        }
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                    }
+                });
+            }
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+            uint64_t file_events = 0;
+            for (size_t i = 0; i < chunks.size(); ++i)
+            {
+                if (errors[i])
+                {
+                    std::rethrow_exception(errors[i]);
+                }
+                file_events += chunk_events[i];
+                hits += chunk_hits[i];
+            }
+            events += file_events;
+            std::cout << input << ": " << file_events << " events" << std::endl;
+        }
+
+        const std::string output = vm["output"].as<std::string>();
+        TH1::AddDirectory(false);
+        TFile tfile(output.c_str(), "RECREATE");
+        if (tfile.IsZombie())
+        {
+            throw std::runtime_error("Can't create " + output);
+        }
+        Histograms::write(histograms, tfile);
+        tfile.Close();
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Total: " << events << " events, " << hits << " hits in " << std::fixed
+                  << std::setprecision(2) << seconds << " s -> " << output << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
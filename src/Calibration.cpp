@@ -0,0 +1,226 @@
+#include "Calibration.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SOCO_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define SOCO_X86_KERNELS 0
+#endif
+
+namespace SOCO
+{
+
+namespace
+{
+
+constexpr size_t IDS = Calibration::IDS;
+
+using CalibrateFn = void (*)(const double* table,
+                             size_t coefficients,
+                             const uint16_t* ids,
+                             const uint16_t* adcs,
+                             size_t n,
+                             float* energies);
+
+void calibrateScalar(const double* table,
+                     const size_t coefficients,
+                     const uint16_t* ids,
+                     const uint16_t* adcs,
+                     const size_t n,
+                     float* energies)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        const size_t id  = ids[i];
+        const double adc = adcs[i];
+        double e         = 0;
+        for (size_t k = coefficients; k-- > 0;)
+        {
+            e = e * adc + table[k * IDS + id];
+        }
+        energies[i] = static_cast<float>(e);
+    }
+}
+
+#if SOCO_X86_KERNELS
+
+// 4 hits per iteration, the coefficients are gathered from the tables by id
+// Multiply and add instead of FMA, so the results are the same as with the scalar kernel.
+__attribute__((target("avx2"))) void calibrateAVX2(const double* table,
+                                                   const size_t coefficients,
+                                                   const uint16_t* ids,
+                                                   const uint16_t* adcs,
+                                                   const size_t n,
+                                                   float* energies)
+{
+    // masked gather with all lanes enabled, the unmasked one reads an undefined source register
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128i id  = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ids + i)));
+        const __m128i raw = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(adcs + i)));
+        const __m256d adc = _mm256_cvtepi32_pd(raw);
+        __m256d e         = _mm256_setzero_pd();
+        for (size_t k = coefficients; k-- > 0;)
+        {
+            const __m256d c =
+                _mm256_mask_i32gather_pd(_mm256_setzero_pd(), table + k * IDS, id, all, sizeof(double));
+            e               = _mm256_add_pd(_mm256_mul_pd(e, adc), c);
+        }
+        _mm_storeu_ps(energies + i, _mm256_cvtpd_ps(e));
+    }
+    calibrateScalar(table, coefficients, ids + i, adcs + i, n - i, energies + i);
+}
+
+#endif /* SOCO_X86_KERNELS */
+
+struct Kernel
+{
+    CalibrateFn function;
+    const char* name;
+};
+
+Kernel selectKernel()
+{
+    const char* env         = std::getenv("SOCO_SIMD");
+    const std::string limit = env ? env : "";
+#if SOCO_X86_KERNELS
+    __builtin_cpu_init();
+    if (limit != "scalar" && limit != "ssse3" && __builtin_cpu_supports("avx2"))
+    {
+        return Kernel{calibrateAVX2, "avx2"};
+    }
+#endif /* SOCO_X86_KERNELS */
+    return Kernel{calibrateScalar, "scalar"};
+}
+
+const Kernel& kernel()
+{
+    static const Kernel selected = selectKernel();
+    return selected;
+}
+
+} // namespace {anonymous}
+
+constexpr size_t Calibration::IDS;
+
+Calibration::Calibration()
+    : table_()
+    , calibrated_()
+    , coefficients_{0}
+{
+}
+
+Calibration::Calibration(const std::string& filename)
+    : Calibration()
+{
+    load(filename);
+}
+
+void Calibration::load(const std::string& filename)
+{
+    std::ifstream in(filename);
+    if (!in)
+    {
+        throw std::runtime_error("Calibration::load - can't open " + filename);
+    }
+
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(in, line))
+    {
+        ++line_number;
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.erase(comment);
+        }
+
+        std::istringstream ss(line);
+        unsigned long id;
+        if (!(ss >> id))
+        {
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+            {
+                continue;
+            }
+            throw std::runtime_error("Calibration::load - " + filename + ":" + std::to_string(line_number) +
+                                     ": expected an id");
+        }
+        // hdtv style "id: c0 c1"
+        if (ss.peek() == ':')
+        {
+            ss.get();
+        }
+
+        std::vector<double> coefficients;
+        double c;
+        while (ss >> c)
+        {
+            coefficients.push_back(c);
+        }
+        if (!ss.eof() || coefficients.empty() || id >= IDS)
+        {
+            throw std::runtime_error("Calibration::load - " + filename + ":" + std::to_string(line_number) +
+                                     ": expected an id and coefficients");
+        }
+        set(static_cast<uint16_t>(id), coefficients);
+    }
+}
+
+void Calibration::set(const uint16_t id, const std::vector<double>& coefficients)
+{
+    if (calibrated_[id])
+    {
+        throw std::runtime_error("Calibration::set - id " + std::to_string(id) + " is already calibrated");
+    }
+    if (coefficients.size() > coefficients_)
+    {
+        // the new higher coefficients are 0 for all ids
+        table_.resize(coefficients.size() * IDS, 0);
+        if (coefficients_ == 0)
+        {
+            std::fill(table_.begin(), table_.begin() + IDS, UNCALIBRATED_ENERGY);
+        }
+        coefficients_ = coefficients.size();
+    }
+    for (size_t k = 0; k < coefficients_; ++k)
+    {
+        table_[k * IDS + id] = k < coefficients.size() ? coefficients[k] : 0;
+    }
+    calibrated_.set(id);
+}
+
+void Calibration::apply(const uint16_t* ids, const uint16_t* adcs, const size_t n, float* energies) const
+{
+    if (coefficients_ == 0)
+    {
+        std::fill(energies, energies + n, UNCALIBRATED_ENERGY);
+        return;
+    }
+    kernel().function(table_.data(), coefficients_, ids, adcs, n, energies);
+}
+
+void Calibration::apply(EventBatch& batch) const
+{
+    if (batch.energies.size() < batch.ids.size())
+    {
+        batch.energies.resize(batch.ids.size());
+    }
+    apply(batch.ids.data(), batch.adcs.data(), batch.hits, batch.energies.data());
+}
+
+const char* calibrationKernel()
+{
+    return kernel().name;
+}
+
+} // namespace SOCO
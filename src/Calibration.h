@@ -0,0 +1,93 @@
+#ifndef SOCO_CALIBRATION_HH
+#define SOCO_CALIBRATION_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "EventBatch.h"
+
+namespace SOCO
+{
+
+// Energy of hits of ids without calibration
+constexpr float UNCALIBRATED_ENERGY = -1;
+
+// Polynomial energy calibration of each detector id
+// Calibration files have one line "id c0 c1 c2 ..." per id, for E = c0 + c1 * adc + c2 * adc^2 ...
+// and '#' starts a comment. The coefficients are stored in dense tables indexed by id, so calibrating
+// a hit is one table lookup per coefficient and a Horner evaluation, without searching for the id.
+class Calibration
+{
+    public:
+    // Size of the tables, one entry for every possible id
+    static constexpr size_t IDS = 65536;
+
+    Calibration();
+
+    explicit Calibration(const std::string& filename);
+
+    // Adds the calibrations of all ids in the file
+    void load(const std::string& filename);
+
+    // Coefficients in increasing order, an id can only be set once
+    void set(uint16_t id, const std::vector<double>& coefficients);
+
+    bool isCalibrated(const uint16_t id) const { return calibrated_[id]; }
+
+    size_t numberOfIds() const { return calibrated_.count(); }
+
+    // Largest number of coefficients of any id
+    size_t numberOfCoefficients() const { return coefficients_; }
+
+    double energy(const uint16_t id, const double adc) const
+    {
+        double e = 0;
+        for (size_t k = coefficients_; k-- > 0;)
+        {
+            e = e * adc + table_[k * IDS + id];
+        }
+        return e;
+    }
+
+    // Calibrates n hits with the best kernel for the running CPU, see calibrationKernel
+    void apply(const uint16_t* ids, const uint16_t* adcs, size_t n, float* energies) const;
+
+    // Fills batch.energies for all hits of the batch
+    void apply(EventBatch& batch) const;
+
+    private:
+    // coefficient k of an id at k * IDS + id, uncalibrated ids evaluate to UNCALIBRATED_ENERGY
+    std::vector<double> table_;
+    std::bitset<IDS> calibrated_;
+    size_t coefficients_;
+};
+
+// Evaluates the calibration for n hits (AVX2 or scalar), selected once at runtime
+// The environment variable SOCO_SIMD=scalar restricts the selection, like for deinterleaveHits.
+const char* calibrationKernel();
+
+} // namespace SOCO
+
+#endif // SOCO_CALIBRATION_HH
@@ -0,0 +1,140 @@
+#include "ConversionStats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/resource.h>
+
+namespace
+{
+
+std::string escape(const std::string& str)
+{
+    std::string result;
+    for (const char c : str)
+    {
+        switch (c)
+        {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                result += buf;
+            }
+            else
+            {
+                result += c;
+            }
+        }
+    }
+    return result;
+}
+
+void writeJson(std::ostream& out, const ConversionStats& s, const std::string& indent)
+{
+    const double mb = s.input_bytes / 1e6;
+    out << indent << "\"input\": \"" << escape(s.input) << "\",\n"
+        << indent << "\"output\": \"" << escape(s.output) << "\",\n"
+        << indent << "\"events\": " << s.events << ",\n"
+        << indent << "\"hits\": " << s.hits << ",\n"
+        << indent << "\"input_bytes\": " << s.input_bytes << ",\n"
+        << indent << "\"output_bytes\": " << s.output_bytes << ",\n"
+        << indent << "\"map_seconds\": " << s.map_seconds << ",\n"
+        << indent << "\"io_wait_seconds\": " << s.io_wait_seconds << ",\n"
+        << indent << "\"decode_seconds\": " << s.decode_seconds << ",\n"
+        << indent << "\"fill_seconds\": " << s.fill_seconds << ",\n"
+        << indent << "\"write_seconds\": " << s.write_seconds << ",\n"
+        << indent << "\"total_seconds\": " << s.total_seconds << ",\n"
+        << indent << "\"events_per_second\": " << (s.total_seconds > 0 ? s.events / s.total_seconds : 0) << ",\n"
+        << indent << "\"mb_per_second\": " << (s.total_seconds > 0 ? mb / s.total_seconds : 0) << ",\n"
+        << indent << "\"peak_rss_kb\": " << s.peak_rss_kb << "\n";
+}
+
+} // namespace {anonymous}
+
+ConversionStats& ConversionStats::operator+=(const ConversionStats& rhs)
+{
+    map_seconds += rhs.map_seconds;
+    io_wait_seconds += rhs.io_wait_seconds;
+    decode_seconds += rhs.decode_seconds;
+    fill_seconds += rhs.fill_seconds;
+    write_seconds += rhs.write_seconds;
+    total_seconds += rhs.total_seconds;
+    events += rhs.events;
+    hits += rhs.hits;
+    input_bytes += rhs.input_bytes;
+    output_bytes += rhs.output_bytes;
+    peak_rss_kb = std::max(peak_rss_kb, rhs.peak_rss_kb);
+    return *this;
+}
+
+std::string ConversionStats::summary() const
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << input << ": " << events << " events, " << hits << " hits, "
+        << input_bytes / 1e6 << " MB -> " << output_bytes / 1e6 << " MB in " << total_seconds << " s ("
+        << (total_seconds > 0 ? input_bytes / 1e6 / total_seconds : 0) << " MB/s; map " << map_seconds
+        << " s, decode " << decode_seconds << " s, io wait " << io_wait_seconds << " s, fill "
+        << fill_seconds << " s, write " << write_seconds << " s, peak RSS " << peak_rss_kb / 1024 << " MiB)";
+    return out.str();
+}
+
+long peakRSSKilobytes()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == -1)
+    {
+        return 0;
+    }
+    return usage.ru_maxrss;
+}
+
+void writeStatsJson(const std::string& filename,
+                    const std::vector<ConversionStats>& files,
+                    const double wall_seconds,
+                    const int threads)
+{
+    std::ofstream out(filename);
+    if (!out)
+    {
+        throw std::runtime_error("Can't open " + filename);
+    }
+
+    ConversionStats total;
+    for (const auto& s : files)
+    {
+        total += s;
+    }
+
+    out << std::setprecision(6) << std::fixed;
+    out << "{\n"
+        << "  \"threads\": " << threads << ",\n"
+        << "  \"wall_seconds\": " << wall_seconds << ",\n"
+        << "  \"events_per_second\": " << (wall_seconds > 0 ? total.events / wall_seconds : 0) << ",\n"
+        << "  \"mb_per_second\": " << (wall_seconds > 0 ? total.input_bytes / 1e6 / wall_seconds : 0) << ",\n"
+        << "  \"total\": {\n";
+    writeJson(out, total, "    ");
+    out << "  },\n"
+        << "  \"files\": [";
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        out << (i ? ",\n" : "\n") << "    {\n";
+        writeJson(out, files[i], "      ");
+        out << "    }";
+    }
+    out << "\n  ]\n}\n";
+
+    if (!out)
+    {
+        throw std::runtime_error("Failed to write " + filename);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef SOCO2ROOT_CONVERSIONSTATS_H
+#define SOCO2ROOT_CONVERSIONSTATS_H
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Timings and throughput of the conversion of one file
+// Stage times of files converted in chunks are summed over all chunk threads.
+struct ConversionStats
+{
+    std::string input;
+    std::string output;
+
+    double map_seconds     = 0; // mapFile: mmap, read to memory or open the stream
+    double io_wait_seconds = 0; // decoding blocked on the read-ahead of streamed files
+    double decode_seconds  = 0; // EventReader::readBatch, including page faults; when pipelined,
+                                // only the time the tree waited for the decoder thread
+    double fill_seconds    = 0; // TTree::Fill, serialisation and compression of full baskets
+    double write_seconds   = 0; // TFile::Write and Close, compression of the remaining baskets
+    double total_seconds   = 0;
+
+    uint64_t events       = 0;
+    uint64_t hits         = 0;
+    uint64_t input_bytes  = 0;
+    uint64_t output_bytes = 0;
+    long peak_rss_kb      = 0; // of the whole process, at the end of the conversion
+
+    // Adds all times and counts, keeps the maximum peak RSS
+    ConversionStats& operator+=(const ConversionStats& rhs);
+
+    std::string summary() const;
+};
+
+// Seconds since start
+inline double secondsSince(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+long peakRSSKilobytes();
+
+void writeStatsJson(const std::string& filename,
+                    const std::vector<ConversionStats>& files,
+                    double wall_seconds,
+                    int threads);
+
+#endif // SOCO2ROOT_CONVERSIONSTATS_H
@@ -0,0 +1,160 @@
+#ifndef SOCO_EVENTBATCH_HH
+#define SOCO_EVENTBATCH_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "EventFilter.h"
+#include "EventView.h"
+#include "HitKernels.h"
+
+namespace SOCO
+{
+
+// Structure-of-arrays buffer for many events, see EventReader::readBatch
+// The hits of event i are [offsets[i], offsets[i + 1]) in ids, adcs and timestamps.
+// event_timestamps holds the timestamp of the trigger hit of each event, see EventView::timestamp.
+// energies is only filled by Calibration::apply.
+// The arrays only grow, so they may be larger than events and hits.
+struct EventBatch
+{
+    size_t events = 0;
+    size_t hits   = 0;
+    std::vector<uint16_t> trigger_ids;
+    std::vector<uint64_t> event_timestamps;
+    std::vector<uint32_t> offsets = std::vector<uint32_t>(1, 0);
+    std::vector<uint16_t> ids;
+    std::vector<uint16_t> adcs;
+    std::vector<uint64_t> timestamps;
+    std::vector<float> energies;
+
+    void clear() noexcept
+    {
+        events = 0;
+        hits   = 0;
+    }
+
+    size_t multiplicity(const size_t event) const { return offsets[event + 1] - offsets[event]; }
+
+    // readable: bytes that may be read from view.data(), at least view.size()
+    void append(const EventView& view, const size_t readable)
+    {
+        const size_t multiplicity = view.multiplicity();
+        reserve(multiplicity);
+
+        trigger_ids[events]      = view.trigger_id();
+        event_timestamps[events] = view.timestamp();
+        deinterleaveHits(view.data() + EventView::sizeOf(0),
+                         multiplicity,
+                         readable - EventView::sizeOf(0),
+                         ids.data() + hits,
+                         adcs.data() + hits,
+                         timestamps.data() + hits);
+        hits += multiplicity;
+        ++events;
+        offsets[events] = static_cast<uint32_t>(hits);
+    }
+
+    // Appends only the hits kept by filter, the event itself must be accepted by filter
+    void append(const EventView& view, const EventFilter& filter)
+    {
+        const size_t multiplicity = view.multiplicity();
+        reserve(multiplicity);
+
+        trigger_ids[events]      = view.trigger_id();
+        event_timestamps[events] = view.timestamp();
+        for (const HitView hit : view)
+        {
+            if (filter.keep(hit))
+            {
+                ids[hits]        = hit.id();
+                adcs[hits]       = hit.adc();
+                timestamps[hits] = hit.timestamp();
+                ++hits;
+            }
+        }
+        ++events;
+        offsets[events] = static_cast<uint32_t>(hits);
+    }
+
+    // Copies event i of other
+    void append(const EventBatch& other, const size_t i)
+    {
+        const size_t first        = other.offsets[i];
+        const size_t multiplicity = other.multiplicity(i);
+        reserve(multiplicity);
+
+        trigger_ids[events]      = other.trigger_ids[i];
+        event_timestamps[events] = other.event_timestamps[i];
+        std::copy_n(other.ids.data() + first, multiplicity, ids.data() + hits);
+        std::copy_n(other.adcs.data() + first, multiplicity, adcs.data() + hits);
+        std::copy_n(other.timestamps.data() + first, multiplicity, timestamps.data() + hits);
+        hits += multiplicity;
+        ++events;
+        offsets[events] = static_cast<uint32_t>(hits);
+    }
+
+    // Appends an event with the multiplicity hits of separate arrays
+    void append(const uint16_t trigger_id,
+                const uint64_t timestamp,
+                const uint16_t* hit_ids,
+                const uint16_t* hit_adcs,
+                const uint64_t* hit_timestamps,
+                const size_t multiplicity)
+    {
+        reserve(multiplicity);
+
+        trigger_ids[events]      = trigger_id;
+        event_timestamps[events] = timestamp;
+        std::copy_n(hit_ids, multiplicity, ids.data() + hits);
+        std::copy_n(hit_adcs, multiplicity, adcs.data() + hits);
+        std::copy_n(hit_timestamps, multiplicity, timestamps.data() + hits);
+        hits += multiplicity;
+        ++events;
+        offsets[events] = static_cast<uint32_t>(hits);
+    }
+
+    private:
+    // Room for one more event with multiplicity hits
+    void reserve(const size_t multiplicity)
+    {
+        if (events + 1 > trigger_ids.size())
+        {
+            trigger_ids.resize(std::max<size_t>(2 * trigger_ids.size(), 1024));
+            event_timestamps.resize(trigger_ids.size());
+            offsets.resize(trigger_ids.size() + 1);
+        }
+        if (hits + multiplicity > ids.size())
+        {
+            const size_t size = std::max<size_t>(2 * ids.size(), std::max<size_t>(hits + multiplicity, 4096));
+            ids.resize(size);
+            adcs.resize(size);
+            timestamps.resize(size);
+        }
+    }
+};
+
+} // namespace SOCO
+
+#endif // SOCO_EVENTBATCH_HH
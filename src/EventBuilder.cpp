@@ -0,0 +1,154 @@
+#include "EventBuilder.h"
+
+#include <algorithm>
+
+namespace SOCO
+{
+
+namespace
+{
+constexpr size_t MAX_MULTIPLICITY = std::numeric_limits<uint8_t>::max();
+}
+
+EventBuilder::EventBuilder(NextBatch next,
+                           const uint64_t window,
+                           const uint64_t reorder_window,
+                           const size_t read_ahead)
+    : next_{std::move(next)}
+    , window_{window}
+    , reorder_window_{reorder_window}
+    , adaptive_{reorder_window == 0}
+    , read_ahead_{std::max<size_t>(read_ahead, 1)}
+    , input_{}
+    , pending_{}
+    , head_{0}
+    , final_{0}
+    , exhausted_{false}
+    , latest_{0}
+    , assigned_{false}
+    , last_{0, 0, 0}
+    , unordered_{0}
+    , duplicates_{0}
+    , ids_(MAX_MULTIPLICITY)
+    , adcs_(MAX_MULTIPLICITY)
+    , timestamps_(MAX_MULTIPLICITY)
+{
+}
+
+bool EventBuilder::refill()
+{
+    if (exhausted_)
+    {
+        return false;
+    }
+
+    // drop the assigned hits, so hits that arrive too late are still sorted in
+    pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(head_));
+    final_ -= head_;
+    head_ = 0;
+
+    if (next_(input_, read_ahead_) == 0)
+    {
+        exhausted_ = true;
+        final_     = pending_.size();
+        return true;
+    }
+
+    const size_t sorted = pending_.size();
+    pending_.reserve(sorted + input_.hits);
+    for (size_t i = 0; i < input_.events; ++i)
+    {
+        uint64_t first = std::numeric_limits<uint64_t>::max();
+        uint64_t last  = 0;
+        for (size_t h = input_.offsets[i]; h < input_.offsets[i + 1]; ++h)
+        {
+            const FlatHit hit = {input_.timestamps[h], input_.ids[h], input_.adcs[h]};
+            if (assigned_ && hit < last_)
+            {
+                ++unordered_;
+            }
+            first = std::min(first, hit.timestamp);
+            last  = std::max(last, hit.timestamp);
+            pending_.push_back(hit);
+        }
+        if (first <= last)
+        {
+            if (adaptive_)
+            {
+                reorder_window_ = std::max(reorder_window_, 2 * (last - first));
+            }
+            latest_ = std::max(latest_, last);
+        }
+    }
+    // the hits of each event and of consecutive events are mostly in order already
+    std::sort(pending_.begin() + static_cast<std::ptrdiff_t>(sorted), pending_.end());
+    const auto middle = pending_.begin() + static_cast<std::ptrdiff_t>(sorted);
+    std::inplace_merge(pending_.begin(), middle, pending_.end());
+
+    if (latest_ >= reorder_window_)
+    {
+        const FlatHit bound = {latest_ - reorder_window_,
+                               std::numeric_limits<uint16_t>::max(),
+                               std::numeric_limits<uint16_t>::max()};
+        final_ = static_cast<size_t>(std::upper_bound(pending_.begin(), pending_.end(), bound) -
+                                     pending_.begin());
+    }
+    return true;
+}
+
+bool EventBuilder::buildEvent(EventBatch& batch)
+{
+    for (;;)
+    {
+        // all hits within the window of the first hit have to be final
+        while (head_ == final_ || (!exhausted_ && !complete()))
+        {
+            if (!refill())
+            {
+                return false;
+            }
+        }
+
+        while (head_ < final_ && assigned_ && pending_[head_] == last_)
+        {
+            ++head_;
+            ++duplicates_;
+        }
+        if (head_ == final_)
+        {
+            continue;
+        }
+
+        const uint64_t start = pending_[head_].timestamp;
+        size_t multiplicity  = 0;
+        while (head_ < final_ && multiplicity < MAX_MULTIPLICITY &&
+               pending_[head_].timestamp - start <= window_)
+        {
+            const FlatHit& hit = pending_[head_++];
+            if (assigned_ && hit == last_)
+            {
+                ++duplicates_;
+                continue;
+            }
+            ids_[multiplicity]        = hit.id;
+            adcs_[multiplicity]       = hit.adc;
+            timestamps_[multiplicity] = hit.timestamp;
+            ++multiplicity;
+            last_     = hit;
+            assigned_ = true;
+        }
+        batch.append(ids_[0], start, ids_.data(), adcs_.data(), timestamps_.data(), multiplicity);
+        return true;
+    }
+}
+
+size_t EventBuilder::readBatch(EventBatch& batch, const size_t max_events)
+{
+    batch.clear();
+    while (batch.events < max_events && buildEvent(batch))
+    {
+    }
+    return batch.events;
+}
+
+} // namespace SOCO
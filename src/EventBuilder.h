@@ -0,0 +1,125 @@
+#ifndef SOCO_EVENTBUILDER_HH
+#define SOCO_EVENTBUILDER_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "EventBatch.h"
+
+namespace SOCO
+{
+
+// Rebuilds the events of a time-ordered stream of events with a new coincidence window
+// The hits of all input events are flattened into one stream sorted by time and regrouped in a
+// single pass: an event starts with the first hit that is not yet assigned and contains all
+// following hits at most window later (up to 255, the limit of the file format). Trigger id and
+// timestamp of a rebuilt event are those of its first hit.
+// The input only has to be sorted by event. A hit is assigned once no earlier hit can follow, i.e.
+// when it is more than the reorder window earlier than the latest hit read. With reorder_window 0,
+// it is twice the longest input event so far. Hits that arrive later are counted by unorderedHits.
+// Identical hits in several input events, e.g. from overlapping events of the original event
+// building, are only used once.
+class EventBuilder
+{
+    public:
+    // Same as EventReader::readBatch, e.g. of an EventReader or EventMerger
+    using NextBatch = std::function<size_t(EventBatch&, size_t)>;
+
+    EventBuilder(NextBatch next,
+                 uint64_t window,
+                 uint64_t reorder_window = 0,
+                 size_t read_ahead       = 4096);
+
+    // NonCopyable
+    EventBuilder(const EventBuilder&) = delete;
+    EventBuilder& operator=(const EventBuilder&) = delete;
+
+    // Same as EventReader::readBatch, the rebuilt events in time order
+    size_t readBatch(EventBatch& batch, size_t max_events);
+
+    // Hits that were read after a later hit had already been assigned to an event
+    // The output is only completely time-ordered if this is 0.
+    uint64_t unorderedHits() const { return unordered_; }
+
+    // Hits that were dropped as copies of the previous hit
+    uint64_t duplicateHits() const { return duplicates_; }
+
+    private:
+    struct FlatHit
+    {
+        uint64_t timestamp;
+        uint16_t id;
+        uint16_t adc;
+
+        bool operator<(const FlatHit& rhs) const
+        {
+            return timestamp < rhs.timestamp ||
+                   (timestamp == rhs.timestamp && (id < rhs.id || (id == rhs.id && adc < rhs.adc)));
+        }
+
+        bool operator==(const FlatHit& rhs) const
+        {
+            return timestamp == rhs.timestamp && id == rhs.id && adc == rhs.adc;
+        }
+    };
+
+    // Reads the next input batch into the pending hits, false if the input was already exhausted
+    bool refill();
+
+    // True if a final hit is beyond the window of the first unassigned hit, head_ < final_
+    bool complete() const
+    {
+        return pending_[final_ - 1].timestamp - pending_[head_].timestamp > window_;
+    }
+
+    // Appends the next rebuilt event to batch, false at the end of the input
+    bool buildEvent(EventBatch& batch);
+
+    NextBatch next_;
+    uint64_t window_;
+    uint64_t reorder_window_;
+    bool adaptive_;
+    size_t read_ahead_;
+    EventBatch input_;
+    // sorted hits, [head_, final_) are final, [final_, end) may still get earlier hits
+    std::vector<FlatHit> pending_;
+    size_t head_;
+    size_t final_;
+    bool exhausted_;
+    uint64_t latest_;
+    // last hit assigned to an event
+    bool assigned_;
+    FlatHit last_;
+    uint64_t unordered_;
+    uint64_t duplicates_;
+    // hits of the event that is built
+    std::vector<uint16_t> ids_;
+    std::vector<uint16_t> adcs_;
+    std::vector<uint64_t> timestamps_;
+};
+
+} // namespace SOCO
+
+#endif // SOCO_EVENTBUILDER_HH
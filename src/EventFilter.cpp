@@ -0,0 +1,130 @@
+#include "EventFilter.h"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace SOCO
+{
+
+EventFilter::EventFilter()
+    : allowed_{}
+    , denied_{}
+    , ids_{}
+    , triggers_{}
+    , min_multiplicity_{0}
+    , max_multiplicity_{std::numeric_limits<uint8_t>::max()}
+    , min_adc_{0}
+    , max_adc_{std::numeric_limits<uint16_t>::max()}
+    , filters_hits_{false}
+    , filters_triggers_{false}
+{
+    allowed_.set();
+    ids_.set();
+    triggers_.set();
+}
+
+void EventFilter::setMultiplicity(const size_t min, const size_t max)
+{
+    if (min > max)
+    {
+        throw std::runtime_error("EventFilter::setMultiplicity - minimum is larger than maximum");
+    }
+    min_multiplicity_ = min;
+    max_multiplicity_ = max;
+}
+
+void EventFilter::allowIds(const std::vector<uint16_t>& ids)
+{
+    allowed_.reset();
+    for (const uint16_t id : ids)
+    {
+        allowed_.set(id);
+    }
+    updateIds();
+}
+
+void EventFilter::denyIds(const std::vector<uint16_t>& ids)
+{
+    for (const uint16_t id : ids)
+    {
+        denied_.set(id);
+    }
+    updateIds();
+}
+
+void EventFilter::selectTriggers(const std::vector<uint16_t>& trigger_ids)
+{
+    triggers_.reset();
+    for (const uint16_t id : trigger_ids)
+    {
+        triggers_.set(id);
+    }
+    filters_triggers_ = !triggers_.all();
+}
+
+void EventFilter::setAdcWindow(const uint16_t min, const uint16_t max)
+{
+    if (min > max)
+    {
+        throw std::runtime_error("EventFilter::setAdcWindow - minimum is larger than maximum");
+    }
+    min_adc_ = min;
+    max_adc_ = max;
+    updateIds();
+}
+
+void EventFilter::updateIds()
+{
+    ids_          = allowed_ & ~denied_;
+    filters_hits_ = !ids_.all() || min_adc_ > 0 || max_adc_ < std::numeric_limits<uint16_t>::max();
+}
+
+std::vector<uint16_t> EventFilter::parseIdList(const std::string& list)
+{
+    std::vector<uint16_t> ids;
+    std::istringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (item.empty())
+        {
+            continue;
+        }
+        const size_t dash = item.find('-', 1);
+        unsigned long first, last;
+        try
+        {
+            size_t end;
+            first = std::stoul(item, &end);
+            last  = first;
+            if (dash != std::string::npos)
+            {
+                if (end != dash)
+                {
+                    throw std::invalid_argument(item);
+                }
+                last = std::stoul(item.substr(dash + 1), &end);
+                end += dash + 1;
+            }
+            if (end != item.size())
+            {
+                throw std::invalid_argument(item);
+            }
+        }
+        catch (const std::logic_error&)
+        {
+            throw std::runtime_error("EventFilter::parseIdList - invalid id '" + item + "'");
+        }
+        if (first > last || last > std::numeric_limits<uint16_t>::max())
+        {
+            throw std::runtime_error("EventFilter::parseIdList - invalid id range '" + item + "'");
+        }
+        for (unsigned long id = first; id <= last; ++id)
+        {
+            ids.push_back(static_cast<uint16_t>(id));
+        }
+    }
+    return ids;
+}
+
+} // namespace SOCO
@@ -0,0 +1,111 @@
+#ifndef SOCO_EVENTFILTER_HH
+#define SOCO_EVENTFILTER_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "EventView.h"
+
+namespace SOCO
+{
+
+// Selection of events and hits, evaluated on the raw event data before anything is decoded
+// A hit is kept if its id is allowed and not denied and its adc is inside the window. An event is
+// kept if its trigger id is selected and the number of kept hits is inside the multiplicity window.
+// The default filter keeps everything.
+class EventFilter
+{
+    public:
+    EventFilter();
+
+    void setMultiplicity(size_t min, size_t max = std::numeric_limits<uint8_t>::max());
+
+    // Only hits of these ids are kept, all ids are allowed if this is never called
+    void allowIds(const std::vector<uint16_t>& ids);
+
+    // Hits of these ids are dropped, wins over allowIds
+    void denyIds(const std::vector<uint16_t>& ids);
+
+    // Only events with one of these trigger ids are kept
+    void selectTriggers(const std::vector<uint16_t>& trigger_ids);
+
+    void setAdcWindow(uint16_t min, uint16_t max = std::numeric_limits<uint16_t>::max());
+
+    // Whether any events or hits can be rejected at all
+    bool active() const
+    {
+        return filters_hits_ || filters_triggers_ || min_multiplicity_ > 0 ||
+               max_multiplicity_ < std::numeric_limits<uint8_t>::max();
+    }
+
+    // Whether single hits can be dropped from kept events
+    bool filtersHits() const { return filters_hits_; }
+
+    bool keep(const HitView& hit) const noexcept
+    {
+        const uint16_t adc = hit.adc();
+        return ids_[hit.id()] && adc >= min_adc_ && adc <= max_adc_;
+    }
+
+    bool accept(const EventView& event) const noexcept
+    {
+        if (!triggers_[event.trigger_id()])
+        {
+            return false;
+        }
+        size_t multiplicity = event.multiplicity();
+        if (filters_hits_)
+        {
+            multiplicity = 0;
+            for (const HitView hit : event)
+            {
+                multiplicity += keep(hit);
+            }
+        }
+        return multiplicity >= min_multiplicity_ && multiplicity <= max_multiplicity_;
+    }
+
+    // Comma separated ids and inclusive ranges, e.g. "0-15,20,22"
+    static std::vector<uint16_t> parseIdList(const std::string& list);
+
+    private:
+    void updateIds();
+
+    std::bitset<65536> allowed_;
+    std::bitset<65536> denied_;
+    std::bitset<65536> ids_;
+    std::bitset<65536> triggers_;
+    size_t min_multiplicity_;
+    size_t max_multiplicity_;
+    uint16_t min_adc_;
+    uint16_t max_adc_;
+    bool filters_hits_;
+    bool filters_triggers_;
+};
+
+} // namespace SOCO
+
+#endif // SOCO_EVENTFILTER_HH
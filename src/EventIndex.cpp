@@ -0,0 +1,89 @@
+#include "EventIndex.h"
+
+#include <cassert>
+#include <fstream>
+#include <stdexcept>
+
+namespace SOCO
+{
+
+constexpr uint64_t EventIndex::DEFAULT_STRIDE;
+
+EventIndex::EventIndex(const uint64_t stride,
+                       const uint64_t file_size,
+                       const uint64_t header_events,
+                       const int64_t mtime_ns)
+    : stride_{stride}
+    , file_size_{file_size}
+    , header_events_{header_events}
+    , mtime_ns_{mtime_ns}
+    , events_{0}
+    , offsets_{}
+{
+    assert(stride_ > 0);
+}
+
+void EventIndex::save(const std::string& filename) const
+{
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        throw std::runtime_error("EventIndex::save - can't open " + filename);
+    }
+
+    const uint64_t header[] = {SOCO_INDEX_MAGIC,
+                               stride_,
+                               file_size_,
+                               header_events_,
+                               static_cast<uint64_t>(mtime_ns_),
+                               events_,
+                               offsets_.size()};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(offsets_.data()), offsets_.size() * sizeof(uint64_t));
+
+    if (!out)
+    {
+        throw std::runtime_error("EventIndex::save - failed to write " + filename);
+    }
+}
+
+EventIndex EventIndex::load(const std::string& filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+    {
+        throw std::runtime_error("EventIndex::load - can't open " + filename);
+    }
+
+    uint64_t header[7];
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in || header[0] != SOCO_INDEX_MAGIC || header[1] == 0)
+    {
+        throw std::runtime_error("EventIndex::load - " + filename + " is not a valid index");
+    }
+
+    EventIndex index(header[1], header[2], header[3], static_cast<int64_t>(header[4]));
+    index.events_ = header[5];
+    if (header[6] != (index.events_ + index.stride_ - 1) / index.stride_)
+    {
+        throw std::runtime_error("EventIndex::load - " + filename + " is not a valid index");
+    }
+    index.offsets_.resize(header[6]);
+    in.read(reinterpret_cast<char*>(index.offsets_.data()), header[6] * sizeof(uint64_t));
+    if (!in)
+    {
+        throw std::runtime_error("EventIndex::load - " + filename + " is truncated");
+    }
+    // seek uses the offsets without further checks
+    for (size_t i = 0; i < index.offsets_.size(); ++i)
+    {
+        const bool increasing = (i == 0 || index.offsets_[i] > index.offsets_[i - 1]);
+        if (index.offsets_[i] >= index.file_size_ || !increasing)
+        {
+            throw std::runtime_error("EventIndex::load - " + filename + " has an invalid offset");
+        }
+    }
+    return index;
+}
+
+} // namespace SOCO
@@ -0,0 +1,84 @@
+#ifndef SOCO_EVENTINDEX_HH
+#define SOCO_EVENTINDEX_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SOCO
+{
+
+constexpr uint64_t SOCO_INDEX_MAGIC = UINT64_C(0x534f434f49445832);
+
+// Sparse index of event offsets, one entry for every stride-th event
+// Saved as a sidecar file next to the event file, see sidecarFilename, together with the size,
+// header event count and modification time of the event file to detect a stale index
+class EventIndex
+{
+    public:
+    static constexpr uint64_t DEFAULT_STRIDE = 4096;
+
+    explicit EventIndex(uint64_t stride        = DEFAULT_STRIDE,
+                        uint64_t file_size     = 0,
+                        uint64_t header_events = 0,
+                        int64_t mtime_ns       = 0);
+
+    // Must be called for events 0, stride, 2*stride, ... in order
+    void add(uint64_t offset) { offsets_.push_back(offset); }
+
+    void setNumberOfEvents(uint64_t events) { events_ = events; }
+
+    uint64_t numberOfEvents() const { return events_; }
+
+    uint64_t stride() const { return stride_; }
+
+    uint64_t fileSize() const { return file_size_; }
+
+    // EventHeader::event_count of the event file
+    uint64_t headerEvents() const { return header_events_; }
+
+    int64_t mtimeNs() const { return mtime_ns_; }
+
+    bool empty() const { return offsets_.empty(); }
+
+    // Offset of the closest indexed event at or before event, which is stride * (event / stride)
+    uint64_t offsetBefore(uint64_t event) const { return offsets_[event / stride_]; }
+
+    void save(const std::string& filename) const;
+
+    // Throws if the file is missing or not a valid index, e.g. with offsets beyond the file size
+    static EventIndex load(const std::string& filename);
+
+    static std::string sidecarFilename(const std::string& event_file) { return event_file + ".idx"; }
+
+    private:
+    uint64_t stride_;
+    uint64_t file_size_;
+    uint64_t header_events_;
+    int64_t mtime_ns_;
+    uint64_t events_;
+    std::vector<uint64_t> offsets_;
+};
+
+} // namespace SOCO
+
+#endif // SOCO_EVENTINDEX_HH
@@ -0,0 +1,69 @@
+#include "EventMerger.h"
+
+#include <algorithm>
+
+namespace SOCO
+{
+
+EventMerger::EventMerger(const std::vector<std::string>& filenames,
+                         const size_t read_ahead,
+                         const bool use_mmap,
+                         const size_t stream_memory,
+                         std::shared_ptr<const EventFilter> filter)
+    : read_ahead_{std::max<size_t>(read_ahead, 1)}
+    , sources_{}
+    , heap_{}
+    , unordered_{0}
+{
+    for (const std::string& filename : filenames)
+    {
+        std::unique_ptr<Source> source(new Source());
+        source->reader.mapFile(filename, use_mmap, stream_memory);
+        source->reader.setFilter(filter);
+        sources_.push_back(std::move(source));
+    }
+    for (size_t i = 0; i < sources_.size(); ++i)
+    {
+        if (sources_[i]->reader.readBatch(sources_[i]->batch, read_ahead_))
+        {
+            heap_.emplace(sources_[i]->batch.event_timestamps[0], i);
+        }
+    }
+}
+
+bool EventMerger::advance(const size_t source)
+{
+    Source& s = *sources_[source];
+    if (++s.next == s.batch.events)
+    {
+        s.next = 0;
+        if (!s.reader.readBatch(s.batch, read_ahead_))
+        {
+            return false;
+        }
+    }
+    heap_.emplace(s.batch.event_timestamps[s.next], source);
+    return true;
+}
+
+size_t EventMerger::readBatch(EventBatch& batch, const size_t max_events)
+{
+    batch.clear();
+    while (batch.events < max_events && !heap_.empty())
+    {
+        const Entry next = heap_.top();
+        heap_.pop();
+
+        Source& s = *sources_[next.second];
+        if (next.first < s.last_timestamp)
+        {
+            ++unordered_;
+        }
+        s.last_timestamp = next.first;
+        batch.append(s.batch, s.next);
+        advance(next.second);
+    }
+    return batch.events;
+}
+
+} // namespace SOCO
@@ -0,0 +1,84 @@
+#ifndef SOCO_EVENTMERGER_HH
+#define SOCO_EVENTMERGER_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "EventBatch.h"
+#include "EventReader.h"
+
+namespace SOCO
+{
+
+// Merges the events of several files, each sorted by time, into one time-ordered stream
+// k-way merge with a heap over the next event of every file. Each file is read ahead by at most
+// read_ahead events, so the memory does not depend on the file sizes. Events with the same
+// timestamp keep the order of the files.
+class EventMerger
+{
+    public:
+    EventMerger(const std::vector<std::string>& filenames,
+                size_t read_ahead    = 1024,
+                bool use_mmap                              = true,
+                size_t stream_memory                       = 0,
+                std::shared_ptr<const EventFilter> filter = nullptr);
+
+    // NonCopyable
+    EventMerger(const EventMerger&) = delete;
+    EventMerger& operator=(const EventMerger&) = delete;
+
+    // Same as EventReader::readBatch, the events of all files in time order
+    size_t readBatch(EventBatch& batch, size_t max_events);
+
+    // Events that were earlier than the previous event of the same file
+    // The output is only completely time-ordered if this is 0.
+    uint64_t unorderedEvents() const { return unordered_; }
+
+    private:
+    struct Source
+    {
+        EventReader reader;
+        EventBatch batch;
+        size_t next             = 0;
+        uint64_t last_timestamp = 0;
+    };
+
+    // Next event of source, refilling its batch if necessary
+    bool advance(size_t source);
+
+    size_t read_ahead_;
+    std::vector<std::unique_ptr<Source>> sources_;
+    // timestamp and source of the next event of every source that is not exhausted
+    using Entry = std::pair<uint64_t, size_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap_;
+    uint64_t unordered_;
+};
+
+} // namespace SOCO
+
+#endif // SOCO_EVENTMERGER_HH
@@ -1,5 +1,6 @@
 #include "EventReader.h"
 
+#include <algorithm>
 #include <cstring>
 #include <fcntl.h>
 #include <stdexcept>
@@ -8,6 +9,8 @@
 #include <unistd.h>
 
 #include "FSUtils.h"
+#include "FileStream.h"
+#include "ThreadSaveCout.h"
 
 #define SOCO_LIKELY_UNLIKELY 1
 #if SOCO_LIKELY_UNLIKELY
@@ -30,7 +33,10 @@ template <typename T>
 typename std::enable_if<!std::is_pointer<T>::value, T>::type
 interpret_as(const uint8_t* p, const size_t offset) noexcept
 {
-    return *reinterpret_cast<const T*>(p + offset);
+    // memcpy instead of dereferencing, the data is not aligned
+    T value;
+    std::memcpy(&value, p + offset, sizeof(T));
+    return value;
 }
 
 /* Only available to template deduction if T is a pointer, using TMP to add
@@ -46,32 +52,62 @@ interpret_as(const uint8_t* p, const size_t offset) noexcept
     return reinterpret_cast<ReturnType>(p + offset);
 }
 
+void append(SOCO::EventBatch& batch,
+            const SOCO::EventView& view,
+            const size_t readable,
+            const SOCO::EventFilter* filter)
+{
+    if (!filter || !filter->filtersHits())
+    {
+        batch.append(view, readable);
+    }
+    else
+    {
+        batch.append(view, *filter);
+    }
+}
+
 } // namespace {anonymous}
 
 namespace SOCO
 {
 
-constexpr size_t HIT_SIZE = (2 * sizeof(uint16_t) + sizeof(uint64_t));
 
 EventReader::EventReader()
     : raw_data_{nullptr}
     , mapped_bytes_{0}
+    , mtime_ns_{0}
     , next_{0}
     , first_data_{0}
     , num_events_{0}
     , filename_{}
     , metadata_{}
+    , index_{}
+    , stream_{}
+    , stream_memory_{0}
+    , pending_{0}
+    , io_wait_seconds_{0}
+    , file_mapped_{false}
+    , filter_{}
 {
 }
 
 EventReader::EventReader(EventReader&& r)
     : raw_data_{std::move(r.raw_data_)}
     , mapped_bytes_{std::move(r.mapped_bytes_)}
+    , mtime_ns_{r.mtime_ns_}
     , next_(std::move(r.next_))
     , first_data_{std::move(r.first_data_)}
     , num_events_{std::move(r.num_events_)}
     , filename_{std::move(r.filename_)}
     , metadata_{std::move(r.metadata_)}
+    , index_{std::move(r.index_)}
+    , stream_{std::move(r.stream_)}
+    , stream_memory_{r.stream_memory_}
+    , pending_{r.pending_}
+    , io_wait_seconds_{r.io_wait_seconds_}
+    , file_mapped_{r.file_mapped_}
+    , filter_{std::move(r.filter_)}
 {
     r.raw_data_     = nullptr;
     r.mapped_bytes_ = r.next_ = r.first_data_ = 0;
@@ -90,19 +126,29 @@ EventReader& EventReader::operator=(EventReader&& rhs)
 {
     assert(this != &rhs);
 
-    raw_data_     = std::move(rhs.raw_data_);
-    mapped_bytes_ = std::move(rhs.mapped_bytes_);
-    next_         = std::move(rhs.next_);
-    filename_     = std::move(rhs.filename_);
-    metadata_     = std::move(rhs.metadata_);
+    raw_data_        = std::move(rhs.raw_data_);
+    mapped_bytes_    = std::move(rhs.mapped_bytes_);
+    mtime_ns_        = rhs.mtime_ns_;
+    next_            = std::move(rhs.next_);
+    first_data_      = std::move(rhs.first_data_);
+    num_events_      = std::move(rhs.num_events_);
+    filename_        = std::move(rhs.filename_);
+    metadata_        = std::move(rhs.metadata_);
+    index_           = std::move(rhs.index_);
+    stream_          = std::move(rhs.stream_);
+    stream_memory_   = rhs.stream_memory_;
+    pending_         = rhs.pending_;
+    io_wait_seconds_ = rhs.io_wait_seconds_;
+    file_mapped_     = rhs.file_mapped_;
+    filter_          = std::move(rhs.filter_);
 
     rhs.raw_data_     = nullptr;
-    rhs.mapped_bytes_ = rhs.next_ = 0;
+    rhs.mapped_bytes_ = rhs.next_ = rhs.first_data_ = 0;
 
     return *this;
 }
 
-void EventReader::mapFile(string filename, bool use_mmap)
+void EventReader::mapFile(string filename, bool use_mmap, const size_t stream_memory)
 {
     assert(raw_data_ == nullptr);
     filename_ = std::move(filename);
@@ -116,7 +162,8 @@ void EventReader::mapFile(string filename, bool use_mmap)
     struct stat sb;
     if (use_mmap)
     {
-        raw_data_ = static_cast<const uint8_t*>(FSUtils::mmap(filename_, &sb));
+        raw_data_    = static_cast<const uint8_t*>(FSUtils::mmap(filename_, &sb));
+        file_mapped_ = true;
     }
     else
     {
@@ -127,71 +174,153 @@ void EventReader::mapFile(string filename, bool use_mmap)
                                      " is not a regular file");
         }
 
-        int fd = open(filename_.c_str(), O_RDONLY | O_DIRECT);
-        if (fd == -1)
+        if (stream_memory)
         {
-            // try opening file without O_DIRECT, may be unsupported
-            fd = open(filename_.c_str(), O_RDONLY);
+            stream_memory_ = stream_memory;
+            stream_.reset(new FileStream(filename_, stream_memory_));
         }
-        if (fd == -1)
+        else
         {
-            throw std::runtime_error("EventReader::mapFile - can't open " + filename_ + ": " + strerror(errno));
+            readWholeFile(sb.st_size);
         }
-
-        uint8_t* data = static_cast<uint8_t*>(
-            ::mmap(0, sb.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, 0, 0));
-        assert(data && "mmap-style malloc failed");
-        read(fd, data, sb.st_size);
-        while (close(fd) == -1 && errno == EINTR)
-            ;
-        raw_data_ = data;
     }
     mapped_bytes_ = sb.st_size;
+    mtime_ns_     = static_cast<int64_t>(sb.st_mtim.tv_sec) * 1000000000 + sb.st_mtim.tv_nsec;
     next_         = 0;
 
     readHeader();
 }
 
+void EventReader::readWholeFile(const size_t size)
+{
+    int fd = open(filename_.c_str(), O_RDONLY | O_DIRECT);
+    if (fd == -1)
+    {
+        // try opening file without O_DIRECT, may be unsupported
+        fd = open(filename_.c_str(), O_RDONLY);
+    }
+    if (fd == -1)
+    {
+        throw std::runtime_error("EventReader::mapFile - can't open " + filename_ + ": " + strerror(errno));
+    }
+
+    void* memory = ::mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        const int errnum = errno;
+        close(fd);
+        throw std::runtime_error("EventReader::mapFile - can't allocate memory for " + filename_ + ": " +
+                                 strerror(errnum));
+    }
+    uint8_t* data = static_cast<uint8_t*>(memory);
+
+    // read() may return less than requested, e.g. on network file systems
+    size_t done = 0;
+    int errnum  = 0;
+    while (done < size)
+    {
+        const ssize_t rc = read(fd, data + done, size - done);
+        if (rc == -1)
+        {
+            errnum = errno;
+            if (errnum == EINTR)
+            {
+                continue;
+            }
+            const int flags = fcntl(fd, F_GETFL);
+            if (errnum == EINVAL && flags != -1 && (flags & O_DIRECT))
+            {
+                // O_DIRECT is not supported for the unaligned tail of the file
+                fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+                errnum = 0;
+                continue;
+            }
+            break;
+        }
+        if (rc == 0)
+        {
+            break;
+        }
+        done += static_cast<size_t>(rc);
+    }
+    while (close(fd) == -1 && errno == EINTR)
+        ;
+
+    if (errnum || done != size)
+    {
+        munmap(memory, size);
+        throw std::runtime_error("EventReader::mapFile - failed to read " + filename_ + ": " +
+                                 (errnum ? strerror(errnum) : "unexpected end of file"));
+    }
+    raw_data_ = data;
+}
+
+const uint8_t* EventReader::peek(const size_t n)
+{
+    if (stream_)
+    {
+        // the last event view stays valid until here
+        if (pending_)
+        {
+            const size_t pending = pending_;
+            pending_             = 0;
+            skip(pending);
+        }
+        return stream_->require(n) ? stream_->data() : nullptr;
+    }
+    return (next_ + n <= mapped_bytes_) ? raw_data_ + next_ : nullptr;
+}
+
+void EventReader::skip(const size_t n)
+{
+    if (stream_)
+    {
+        stream_->consume(n);
+    }
+    next_ += n;
+}
+
 void EventReader::readHeader()
 {
-    assert(raw_data_ != nullptr);
-    assert(next_ < mapped_bytes_);
+    assert(raw_data_ != nullptr || stream_ != nullptr);
 
-    if (mapped_bytes_ < next_ + sizeof(EventHeader))
+    const uint8_t* data = peek(sizeof(EventHeader));
+    if (!data)
     {
         throw runtime_error(
             "EventReader::readHeader() - " + filename_ +
             " not enough data in file");
     }
 
-    const EventHeader* header = interpret_as<EventHeader*>(raw_data_, next_);
-    if (header->magic != SOCO_EVENT_MAGIC)
+    const EventHeader header = interpret_as<EventHeader>(data, 0);
+    if (header.magic != SOCO_EVENT_MAGIC)
     {
         throw runtime_error(
             "EventReader::readHeader() - " + filename_ +
             " invalid magic");
     }
-    num_events_ = header->event_count;
+    num_events_ = header.event_count;
 
-    next_ += sizeof(EventHeader);
+    skip(sizeof(EventHeader));
     bool data_start_found = false;
     while (!data_start_found)
     {
-        if (next_ + sizeof(uint64_t) > mapped_bytes_)
+        data = peek(sizeof(uint64_t));
+        if (!data)
         {
             throw runtime_error(
                 "EventReader::readHeader() - " + filename_ +
                 " not enough data in file");
         }
 
-        const uint64_t magic = interpret_as<uint64_t>(raw_data_, next_);
+        const uint64_t magic = interpret_as<uint64_t>(data, 0);
         if (magic == SOCO_META_MAGIC)
         {
             readMetadata();
         }
         else if (magic == SOCO_DATA_MAGIC)
         {
-            next_ += sizeof(uint64_t);
+            skip(sizeof(uint64_t));
             data_start_found = true;
         }
         else
@@ -206,41 +335,74 @@ void EventReader::readHeader()
 
 void EventReader::readMetadata()
 {
-    assert(raw_data_ != nullptr);
-    assert(next_ < mapped_bytes_);
+    assert(raw_data_ != nullptr || stream_ != nullptr);
 
-    while (next_ + sizeof(uint64_t) <= mapped_bytes_)
+    const uint8_t* data;
+    while ((data = peek(sizeof(uint64_t))))
     {
-        const uint64_t magic = interpret_as<uint64_t>(raw_data_, next_);
+        const uint64_t magic = interpret_as<uint64_t>(data, 0);
         if (magic != SOCO_META_MAGIC)
         {
             break;
         }
 
-        if (next_ + sizeof(EventMetadataHeader) > mapped_bytes_)
+        data = peek(sizeof(EventMetadataHeader));
+        if (!data)
         {
             throw runtime_error(
                 "EventReader::readMetadata() - " + filename_ +
                 " not enough data in file");
         }
 
-        const EventMetadataHeader* header = interpret_as<EventMetadataHeader*>(raw_data_, next_);
-        if (next_ + sizeof(EventMetadataHeader) + header->size > mapped_bytes_)
+        const size_t size = interpret_as<EventMetadataHeader>(data, 0).size;
+        if (next_ + sizeof(EventMetadataHeader) + size > mapped_bytes_ ||
+            !(data = peek(sizeof(EventMetadataHeader) + size)))
         {
             throw runtime_error(
                 "EventReader::readMetadata() - " + filename_ +
                 " not enough data in file");
         }
-        next_ += sizeof(EventMetadataHeader);
-        metadata_.emplace_back(interpret_as<char*>(raw_data_, next_),
-                               interpret_as<char*>(raw_data_, next_ + header->size));
-        next_ += header->size;
+        metadata_.emplace_back(interpret_as<char*>(data, sizeof(EventMetadataHeader)),
+                               interpret_as<char*>(data, sizeof(EventMetadataHeader) + size));
+        skip(sizeof(EventMetadataHeader) + size);
     }
 }
 
+void EventReader::setFilter(std::shared_ptr<const EventFilter> filter)
+{
+    // a filter that keeps everything only costs time
+    filter_ = (filter && filter->active()) ? std::move(filter) : nullptr;
+}
+
 std::vector<Event> EventReader::readAllEvents()
 {
     std::vector<Event> events;
+    if (filter_)
+    {
+        size_t pos = first_data_;
+        EventView view;
+        while (stream_ ? getNextEventView(view)
+                       : (raw_data_ && getEventViewAt(view, pos, mapped_bytes_)))
+        {
+            if (filter_->accept(view))
+            {
+                Event e;
+                view.copyTo(e, *filter_);
+                events.push_back(std::move(e));
+            }
+        }
+        return events;
+    }
+    if (stream_)
+    {
+        // no random access, returns the remaining events
+        Event e;
+        while (getNextEvent(e))
+        {
+            events.push_back(std::move(e));
+        }
+        return events;
+    }
     if (!raw_data_)
     {
         return events;
@@ -253,7 +415,7 @@ std::vector<Event> EventReader::readAllEvents()
         timestamp = 0;
 
         const size_t multiplicity = raw_data_[pos++];
-        const size_t size         = multiplicity * HIT_SIZE;
+        const size_t size         = sizeof(uint16_t) + multiplicity * HIT_SIZE;
         if (unlikely((pos + size) > mapped_bytes_))
         {
             break;
@@ -284,33 +446,416 @@ std::vector<Event> EventReader::readAllEvents()
 
 bool EventReader::getNextEvent(Event& e)
 {
-    if (unlikely(!raw_data_ || next_ >= mapped_bytes_))
+    if (stream_)
+    {
+        while (true)
+        {
+            const uint8_t* data = peek(1);
+            if (unlikely(!data))
+            {
+                return false;
+            }
+            const size_t event_size = EventView::sizeOf(data[0]);
+            data                    = peek(event_size);
+            if (unlikely(!data))
+            {
+                return false;
+            }
+            const EventView view(data);
+            if (filter_ && !filter_->accept(view))
+            {
+                skip(event_size);
+                continue;
+            }
+            if (filter_)
+            {
+                view.copyTo(e, *filter_);
+            }
+            else
+            {
+                view.copyTo(e);
+            }
+            skip(event_size);
+            return true;
+        }
+    }
+    if (unlikely(!raw_data_))
     {
         return false;
     }
+    return getEventAt(e, next_, mapped_bytes_);
+}
+
+bool EventReader::getEventAt(Event& e, size_t& pos, const size_t end) const
+{
+    assert(end <= mapped_bytes_);
+    while (true)
+    {
+        if (unlikely(pos >= end))
+        {
+            return false;
+        }
+
+        const size_t event_size = EventView::sizeOf(raw_data_[pos]);
+        if (unlikely((pos + event_size) > end))
+        {
+            return false;
+        }
+        const EventView view(raw_data_ + pos);
+        pos += event_size;
+        if (filter_ && !filter_->accept(view))
+        {
+            continue;
+        }
 
-    const size_t multiplicity = raw_data_[next_++];
-    const size_t event_size   = multiplicity * HIT_SIZE;
+        // only now we are sure to have all the data and can modify e
+        if (filter_)
+        {
+            view.copyTo(e, *filter_);
+        }
+        else
+        {
+            view.copyTo(e);
+        }
+        return true;
+    }
+}
 
-    if (unlikely((next_ + event_size) > mapped_bytes_))
+bool EventReader::getNextEventView(EventView& view)
+{
+    if (stream_)
+    {
+        const uint8_t* data = peek(1);
+        if (unlikely(!data))
+        {
+            return false;
+        }
+        const size_t event_size = EventView::sizeOf(data[0]);
+        data                    = peek(event_size);
+        if (unlikely(!data))
+        {
+            return false;
+        }
+        view     = EventView(data);
+        pending_ = event_size;
+        return true;
+    }
+    if (unlikely(!raw_data_))
     {
         return false;
     }
+    return getEventViewAt(view, next_, mapped_bytes_);
+}
 
-    // only now we are sure to have all the data and can modify e
-    e.clear();
-    e.trigger_id = interpret_as<uint16_t>(raw_data_, next_);
-    next_ += sizeof(uint16_t);
+bool EventReader::getEventViewAt(EventView& view, size_t& pos, const size_t end) const
+{
+    assert(end <= mapped_bytes_);
+    if (unlikely(pos >= end))
+    {
+        return false;
+    }
 
-    e.hits.reserve(multiplicity);
-    for (size_t i = 0; i < multiplicity; ++i)
+    const size_t event_size = EventView::sizeOf(raw_data_[pos]);
+    if (unlikely((pos + event_size) > end))
     {
-        e.hits.emplace_back(interpret_as<uint16_t>(raw_data_, next_),
-                            interpret_as<uint16_t>(raw_data_, next_ + 10),
-                            interpret_as<uint64_t>(raw_data_, next_ + 2));
-        next_ += HIT_SIZE;
+        return false;
     }
+    view = EventView(raw_data_ + pos);
+    pos += event_size;
     return true;
 }
 
+size_t EventReader::readBatch(EventBatch& batch, const size_t max_events)
+{
+    if (!stream_)
+    {
+        return raw_data_ ? readBatchAt(batch, max_events, next_, mapped_bytes_) : 0;
+    }
+
+    batch.clear();
+    EventView view;
+    while (batch.events < max_events && getNextEventView(view))
+    {
+        // the view is at the start of the available stream data
+        if (!filter_ || filter_->accept(view))
+        {
+            append(batch, view, stream_->available(), filter_.get());
+        }
+    }
+    return batch.events;
+}
+
+size_t EventReader::readBatchAt(EventBatch& batch, const size_t max_events, size_t& pos, const size_t end) const
+{
+    batch.clear();
+    EventView view;
+    while (batch.events < max_events && getEventViewAt(view, pos, end))
+    {
+        if (!filter_ || filter_->accept(view))
+        {
+            const size_t readable = mapped_bytes_ - static_cast<size_t>(view.data() - raw_data_);
+            append(batch, view, readable, filter_.get());
+        }
+    }
+    return batch.events;
+}
+
+EventViewRange EventReader::events() const
+{
+    if (stream_)
+    {
+        throw std::runtime_error("EventReader::events() - " + filename_ +
+                                 " is streamed, use getNextEventView");
+    }
+    if (!raw_data_)
+    {
+        return EventViewRange(nullptr, nullptr);
+    }
+    return EventViewRange(raw_data_ + first_data_, raw_data_ + mapped_bytes_);
+}
+
+std::vector<EventChunk> EventReader::splitIntoChunks(const size_t n) const
+{
+    std::vector<EventChunk> chunks;
+    if (!raw_data_ || n == 0 || first_data_ >= mapped_bytes_)
+    {
+        return chunks;
+    }
+
+    const size_t target = (mapped_bytes_ - first_data_) / n + 1;
+    EventChunk chunk{first_data_, first_data_, 0, 0};
+    size_t pos     = first_data_;
+    uint64_t event = 0;
+    while (pos < mapped_bytes_)
+    {
+        const size_t event_size = EventView::sizeOf(raw_data_[pos]);
+        if (unlikely((pos + event_size) > mapped_bytes_))
+        {
+            break;
+        }
+        pos += event_size;
+        ++event;
+
+        if (pos - chunk.begin >= target)
+        {
+            chunk.end    = pos;
+            chunk.events = event - chunk.first_event;
+            chunks.push_back(chunk);
+            chunk = EventChunk{pos, pos, event, 0};
+        }
+    }
+    if (event > chunk.first_event)
+    {
+        chunk.end    = pos;
+        chunk.events = event - chunk.first_event;
+        chunks.push_back(chunk);
+    }
+    return chunks;
+}
+
+const EventIndex& EventReader::buildIndex(const uint64_t stride)
+{
+    index_ = EventIndex(stride, mapped_bytes_, num_events_, mtime_ns_);
+    uint64_t event = 0;
+    if (stream_)
+    {
+        // scan with a second stream, the position of the reader is not changed
+        FileStream stream(filename_, stream_memory_, first_data_);
+        uint64_t pos = first_data_;
+        while (stream.require(1))
+        {
+            const size_t event_size = EventView::sizeOf(stream.data()[0]);
+            if (unlikely(!stream.require(event_size)))
+            {
+                break;
+            }
+            if (event % stride == 0)
+            {
+                index_.add(pos);
+            }
+            stream.consume(event_size);
+            pos += event_size;
+            ++event;
+        }
+    }
+    else if (raw_data_)
+    {
+        size_t pos = first_data_;
+        while (pos < mapped_bytes_)
+        {
+            const size_t event_size = EventView::sizeOf(raw_data_[pos]);
+            if (unlikely((pos + event_size) > mapped_bytes_))
+            {
+                break;
+            }
+            if (event % stride == 0)
+            {
+                index_.add(pos);
+            }
+            pos += event_size;
+            ++event;
+        }
+    }
+    index_.setNumberOfEvents(event);
+    return index_;
+}
+
+bool EventReader::loadIndex()
+{
+    const std::string sidecar = EventIndex::sidecarFilename(filename_);
+    if (!FSUtils::fileExists(sidecar))
+    {
+        return false;
+    }
+
+    EventIndex index;
+    try
+    {
+        index = EventIndex::load(sidecar);
+    }
+    catch (const std::exception& e)
+    {
+        threadsavecout("[W] " + std::string(e.what()) + ", rebuilding the index");
+        return false;
+    }
+    if (index.fileSize() != mapped_bytes_ || index.headerEvents() != num_events_ ||
+        index.mtimeNs() != mtime_ns_)
+    {
+        return false;
+    }
+    index_ = std::move(index);
+    return true;
+}
+
+void EventReader::saveIndex() const
+{
+    index_.save(EventIndex::sidecarFilename(filename_));
+}
+
+const EventIndex& EventReader::index()
+{
+    if (index_.empty() && !loadIndex())
+    {
+        buildIndex();
+    }
+    return index_;
+}
+
+size_t EventReader::refresh()
+{
+    if (stream_)
+    {
+        throw std::runtime_error("EventReader::refresh - " + filename_ + " is streamed");
+    }
+    assert(raw_data_ != nullptr);
+
+    struct stat sb;
+    FSUtils::stat(filename_, &sb);
+    size_t size = static_cast<size_t>(sb.st_size);
+    if (size <= mapped_bytes_)
+    {
+        return 0;
+    }
+
+    void* memory = mremap(const_cast<uint8_t*>(raw_data_), mapped_bytes_, size, MREMAP_MAYMOVE);
+    if (memory == MAP_FAILED)
+    {
+        throw std::runtime_error("EventReader::refresh - can't remap " + filename_ + ": " + strerror(errno));
+    }
+    raw_data_ = static_cast<const uint8_t*>(memory);
+
+    if (!file_mapped_)
+    {
+        // read the new tail into the grown anonymous mapping
+        const int fd = open(filename_.c_str(), O_RDONLY);
+        if (fd == -1)
+        {
+            throw std::runtime_error("EventReader::refresh - can't open " + filename_ + ": " + strerror(errno));
+        }
+        uint8_t* data = static_cast<uint8_t*>(memory);
+        size_t done   = mapped_bytes_;
+        while (done < size)
+        {
+            const ssize_t rc = pread(fd, data + done, size - done, static_cast<off_t>(done));
+            if (rc == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            if (rc <= 0)
+            {
+                break;
+            }
+            done += static_cast<size_t>(rc);
+        }
+        close(fd);
+        if (done < size)
+        {
+            // only what could be read is available, the rest follows with the next refresh
+            mremap(memory, size, done, 0);
+            size = done;
+        }
+    }
+
+    const size_t added = size - mapped_bytes_;
+    mapped_bytes_      = size;
+    mtime_ns_          = static_cast<int64_t>(sb.st_mtim.tv_sec) * 1000000000 + sb.st_mtim.tv_nsec;
+    return added;
+}
+
+double EventReader::ioWaitSeconds() const
+{
+    return io_wait_seconds_ + (stream_ ? stream_->waitSeconds() : 0.);
+}
+
+bool EventReader::seek(const uint64_t n)
+{
+    if ((!raw_data_ && !stream_) || n >= index().numberOfEvents())
+    {
+        return false;
+    }
+
+    const uint64_t first = n - n % index_.stride();
+    next_                = index_.offsetBefore(n);
+    if (stream_)
+    {
+        // restart streaming at the indexed event
+        pending_ = 0;
+        io_wait_seconds_ += stream_->waitSeconds();
+        stream_.reset();
+        stream_.reset(new FileStream(filename_, stream_memory_, next_));
+    }
+    for (uint64_t i = first; i < n; ++i)
+    {
+        const uint8_t* data = peek(1);
+        if (!data)
+        {
+            return false;
+        }
+        const size_t event_size = EventView::sizeOf(*data);
+        if (!peek(event_size))
+        {
+            return false;
+        }
+        skip(event_size);
+    }
+    return true;
+}
+
+std::vector<Event> EventReader::readRange(const uint64_t first, const uint64_t count)
+{
+    std::vector<Event> events;
+    if (!seek(first))
+    {
+        return events;
+    }
+
+    events.reserve(std::min(count, index_.numberOfEvents() - first));
+    Event e;
+    while (events.size() < count && getNextEvent(e))
+    {
+        events.push_back(std::move(e));
+    }
+    return events;
+}
+
 } // namespace SOCO
@@ -23,21 +23,45 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 // This file is based on SOCOv2, https://gitlab.ikp.uni-koeln.de/nima/soco-v2
 
 #include "Event.h"
+#include "EventBatch.h"
+#include "EventFilter.h"
+#include "EventIndex.h"
+#include "EventView.h"
+#include <memory>
 #include <string>
 
 namespace SOCO
 {
 
+class FileStream;
+
+// Event-aligned byte range of the data section, see EventReader::splitIntoChunks
+struct EventChunk
+{
+    size_t begin;
+    size_t end;
+    uint64_t first_event;
+    uint64_t events;
+};
+
 class EventReader
 {
     protected:
     const uint8_t* raw_data_;
     size_t mapped_bytes_;
+    int64_t mtime_ns_;
     size_t next_;
     size_t first_data_;
     uint64_t num_events_;
     std::string filename_;
     std::vector<std::string> metadata_;
+    EventIndex index_;
+    std::unique_ptr<FileStream> stream_;
+    size_t stream_memory_;
+    size_t pending_;
+    double io_wait_seconds_;
+    bool file_mapped_;
+    std::shared_ptr<const EventFilter> filter_;
 
     public:
     explicit EventReader();
@@ -53,20 +77,89 @@ class EventReader
 
     const std::string& operator[](const size_t n) const { return metadata_[n]; }
 
-    void mapFile(std::string filename, bool use_mmap = true);
+    // Files on remote or shared file systems are never mmap-ed. Without mmap, the whole file is read
+    // to memory, unless stream_memory is set: then the file is streamed through a ring buffer of
+    // about stream_memory bytes and only forward iteration (getNextEvent, seek) is available.
+    void mapFile(std::string filename, bool use_mmap = true, size_t stream_memory = 0);
+
+    // Events rejected by the filter are skipped by readAllEvents, getNextEvent, getEventAt, readBatch
+    // and readBatchAt, which also only return the kept hits. Views, chunks, the index and seek always
+    // refer to all events of the file.
+    void setFilter(std::shared_ptr<const EventFilter> filter);
+
+    const EventFilter* filter() const { return filter_.get(); }
 
     std::vector<Event> readAllEvents();
     bool getNextEvent(Event& h);
 
+    // Reads the event at pos and advances pos, never reading beyond end
+    // Does not change the reader state and can be used from several threads
+    bool getEventAt(Event& e, size_t& pos, size_t end) const;
+
+    // Zero-copy variants of getNextEvent and getEventAt, see EventView
+    // For streamed files, the view is only valid until the next call
+    bool getNextEventView(EventView& view);
+    bool getEventViewAt(EventView& view, size_t& pos, size_t end) const;
+
+    // Decodes up to max_events events into the structure-of-arrays batch, replacing its contents
+    // Returns the number of events read, 0 at the end of the file
+    size_t readBatch(EventBatch& batch, size_t max_events);
+    size_t readBatchAt(EventBatch& batch, size_t max_events, size_t& pos, size_t end) const;
+
+    // All complete events for range-based for loops, not available for streamed files
+    EventViewRange events() const;
+
+    // Splits the data section into at most n chunks of similar size on event boundaries
+    // Only the multiplicity bytes are read to walk the framing
+    std::vector<EventChunk> splitIntoChunks(size_t n) const;
+
+    // Builds the sparse offset index with a single scan over the framing
+    const EventIndex& buildIndex(uint64_t stride = EventIndex::DEFAULT_STRIDE);
+
+    // Loads the sidecar index, returns false if it is missing or does not match the size, header
+    // event count and modification time of the file. An unreadable index is reported as warning.
+    bool loadIndex();
+
+    void saveIndex() const;
+
+    // Loads or builds the index on first use
+    const EventIndex& index();
+
+    // Positions the reader such that the next call to getNextEvent returns event number n
+    // Returns false if the file has less than n + 1 complete events
+    bool seek(uint64_t n);
+
+    std::vector<Event> readRange(uint64_t first, uint64_t count);
+
     const std::string& getFilename() const { return filename_; }
 
     uint64_t numberOfEvents() const { return num_events_; }
 
     bool isMapped() const { return (raw_data_ != nullptr); }
 
+    // Size of the mapped file and offset of the first event, see splitIntoChunks
+    size_t mappedBytes() const { return mapped_bytes_; }
+    size_t dataOffset() const { return first_data_; }
+
+    // File offset of the event the next getNextEvent or getNextEventView returns
+    size_t position() const { return next_ + pending_; }
+
+    bool isStreamed() const { return (stream_ != nullptr); }
+
+    // Time spent waiting for the read-ahead thread of streamed files
+    double ioWaitSeconds() const;
+
+    // Makes data appended to the file since mapFile or the last refresh available, keeping the
+    // position, e.g. for files that are still being written. Returns the number of new bytes.
+    // Not available for streamed files.
+    size_t refresh();
+
     private:
     void readHeader();
     void readMetadata();
+    const uint8_t* peek(size_t n);
+    void skip(size_t n);
+    void readWholeFile(size_t size);
 };
 
 } // namespace SOCO
@@ -0,0 +1,265 @@
+#ifndef SOCO_EVENTVIEW_HH
+#define SOCO_EVENTVIEW_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#include "Event.h"
+
+namespace SOCO
+{
+
+// Packed on-disk hit record: id (2), timestamp (8), adc (2)
+constexpr size_t HIT_SIZE = (2 * sizeof(uint16_t) + sizeof(uint64_t));
+
+// Unaligned-safe load of a field from raw event data
+template <typename T>
+inline T load(const uint8_t* p) noexcept
+{
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+// Non-owning view of a packed hit record
+class HitView
+{
+    public:
+    explicit HitView(const uint8_t* data) noexcept
+        : data_{data}
+    {
+    }
+
+    uint16_t id() const noexcept { return load<uint16_t>(data_); }
+
+    uint64_t timestamp() const noexcept { return load<uint64_t>(data_ + 2); }
+
+    uint16_t adc() const noexcept { return load<uint16_t>(data_ + 10); }
+
+    Hit toHit() const { return Hit(id(), adc(), timestamp()); }
+
+    private:
+    const uint8_t* data_;
+};
+
+class HitIterator
+{
+    public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = HitView;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = void;
+    using reference         = HitView;
+
+    explicit HitIterator(const uint8_t* data) noexcept
+        : data_{data}
+    {
+    }
+
+    HitView operator*() const noexcept { return HitView(data_); }
+
+    HitIterator& operator++() noexcept
+    {
+        data_ += HIT_SIZE;
+        return *this;
+    }
+
+    HitIterator operator++(int) noexcept
+    {
+        HitIterator it(*this);
+        data_ += HIT_SIZE;
+        return it;
+    }
+
+    bool operator==(const HitIterator& rhs) const noexcept { return data_ == rhs.data_; }
+
+    bool operator!=(const HitIterator& rhs) const noexcept { return data_ != rhs.data_; }
+
+    private:
+    const uint8_t* data_;
+};
+
+// Non-owning view of a complete event: multiplicity (1), trigger id (2), hits
+// Only valid as long as the underlying data, see EventReader::getNextEventView
+class EventView
+{
+    public:
+    EventView() noexcept
+        : data_{nullptr}
+    {
+    }
+
+    explicit EventView(const uint8_t* data) noexcept
+        : data_{data}
+    {
+    }
+
+    // Size in bytes of an event with the given multiplicity
+    static constexpr size_t sizeOf(size_t multiplicity) noexcept
+    {
+        return 1 + sizeof(uint16_t) + multiplicity * HIT_SIZE;
+    }
+
+    size_t multiplicity() const noexcept { return data_[0]; }
+
+    uint16_t trigger_id() const noexcept { return load<uint16_t>(data_ + 1); }
+
+    size_t size() const noexcept { return sizeOf(multiplicity()); }
+
+    const uint8_t* data() const noexcept { return data_; }
+
+    HitView operator[](size_t n) const noexcept { return HitView(data_ + sizeOf(n)); }
+
+    HitIterator begin() const noexcept { return HitIterator(data_ + sizeOf(0)); }
+
+    HitIterator end() const noexcept { return HitIterator(data_ + size()); }
+
+    // Timestamp of the hit of the trigger detector, 0 if it is not part of the event
+    // Same as the timestamp set by EventReader::readAllEvents
+    uint64_t timestamp() const noexcept
+    {
+        uint64_t result        = 0;
+        const uint16_t trigger = trigger_id();
+        for (const HitView hit : *this)
+        {
+            if (hit.id() == trigger)
+            {
+                result = hit.timestamp();
+            }
+        }
+        return result;
+    }
+
+    // Same result as EventReader::getNextEvent, including the event timestamp
+    void copyTo(Event& e) const
+    {
+        e.clear();
+        e.trigger_id = trigger_id();
+        e.hits.reserve(multiplicity());
+        for (const HitView hit : *this)
+        {
+            e.hits.emplace_back(hit.id(), hit.adc(), hit.timestamp());
+            if (hit.id() == e.trigger_id)
+            {
+                e.timestamp = hit.timestamp();
+            }
+        }
+    }
+
+    // Same as copyTo, but only with the hits kept by filter
+    // The event timestamp is taken from all hits, also if the trigger hit is not kept.
+    template <typename Filter>
+    void copyTo(Event& e, const Filter& filter) const
+    {
+        e.clear();
+        e.trigger_id = trigger_id();
+        e.hits.reserve(multiplicity());
+        for (const HitView hit : *this)
+        {
+            if (hit.id() == e.trigger_id)
+            {
+                e.timestamp = hit.timestamp();
+            }
+            if (filter.keep(hit))
+            {
+                e.hits.emplace_back(hit.id(), hit.adc(), hit.timestamp());
+            }
+        }
+    }
+
+    private:
+    const uint8_t* data_;
+};
+
+// Iterates over the complete events in [data, end), a truncated last event is skipped
+class EventViewIterator
+{
+    public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = EventView;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = void;
+    using reference         = EventView;
+
+    EventViewIterator(const uint8_t* data, const uint8_t* end) noexcept
+        : data_{data}
+        , end_{end}
+    {
+        check();
+    }
+
+    EventView operator*() const noexcept { return EventView(data_); }
+
+    EventViewIterator& operator++() noexcept
+    {
+        data_ += EventView(data_).size();
+        check();
+        return *this;
+    }
+
+    EventViewIterator operator++(int) noexcept
+    {
+        EventViewIterator it(*this);
+        ++(*this);
+        return it;
+    }
+
+    bool operator==(const EventViewIterator& rhs) const noexcept { return data_ == rhs.data_; }
+
+    bool operator!=(const EventViewIterator& rhs) const noexcept { return data_ != rhs.data_; }
+
+    private:
+    void check() noexcept
+    {
+        if (data_ >= end_ || static_cast<size_t>(end_ - data_) < EventView(data_).size())
+        {
+            data_ = end_;
+        }
+    }
+
+    const uint8_t* data_;
+    const uint8_t* end_;
+};
+
+class EventViewRange
+{
+    public:
+    EventViewRange(const uint8_t* data, const uint8_t* end) noexcept
+        : data_{data}
+        , end_{end}
+    {
+    }
+
+    EventViewIterator begin() const noexcept { return EventViewIterator(data_, end_); }
+
+    EventViewIterator end() const noexcept { return EventViewIterator(end_, end_); }
+
+    private:
+    const uint8_t* data_;
+    const uint8_t* end_;
+};
+
+} // namespace SOCO
+
+#endif // SOCO_EVENTVIEW_HH
@@ -0,0 +1,182 @@
+#include "EventWriter.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "FSUtils.h"
+
+namespace SOCO
+{
+
+constexpr size_t EventWriter::DEFAULT_BUFFER_SIZE;
+
+namespace
+{
+
+template <typename T>
+inline uint8_t* store(uint8_t* p, const T& value)
+{
+    std::memcpy(p, &value, sizeof(T));
+    return p + sizeof(T);
+}
+
+void writeFully(const int fd, const uint8_t* data, size_t size, const std::string& filename)
+{
+    while (size)
+    {
+        const ssize_t rc = ::write(fd, data, size);
+        if (rc == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::runtime_error("EventWriter - failed to write " + filename + " (" +
+                                     FSUtils::getErrorDescription(errno) + ")");
+        }
+        data += rc;
+        size -= static_cast<size_t>(rc);
+    }
+}
+
+} // namespace {anonymous}
+
+EventWriter::EventWriter(const std::string& filename,
+                         const std::vector<std::string>& metadata,
+                         const size_t buffer_size,
+                         const bool overwrite)
+    : filename_{filename}
+    , fd_{-1}
+    , buffer_(std::max(buffer_size, EventView::sizeOf(std::numeric_limits<uint8_t>::max())))
+    , used_{0}
+    , events_{0}
+{
+    fd_ = open(filename_.c_str(), O_WRONLY | O_CREAT | (overwrite ? O_TRUNC : O_EXCL), 0644);
+    if (fd_ == -1)
+    {
+        const int errnum = errno;
+        throw std::runtime_error("EventWriter - can't open " + filename_ + " (" +
+                                 FSUtils::getErrorDescription(errnum) + ")" +
+                                 (errnum == EEXIST ? ", not overwriting an existing file" : ""));
+    }
+
+    // the event count is written by close()
+    store(reserve(sizeof(EventHeader)), EventHeader{SOCO_EVENT_MAGIC, 0});
+    for (const auto& block : metadata)
+    {
+        store(reserve(sizeof(EventMetadataHeader)), EventMetadataHeader{SOCO_META_MAGIC, block.size()});
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(block.data());
+        for (size_t done = 0; done < block.size();)
+        {
+            const size_t n = std::min(block.size() - done, buffer_.size());
+            std::memcpy(reserve(n), data + done, n);
+            done += n;
+        }
+    }
+    store(reserve(sizeof(uint64_t)), SOCO_DATA_MAGIC);
+}
+
+EventWriter::~EventWriter()
+{
+    if (fd_ != -1)
+    {
+        try
+        {
+            close();
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "[W] " << e.what() << std::endl;
+        }
+    }
+}
+
+uint8_t* EventWriter::reserve(const size_t n)
+{
+    assert(n <= buffer_.size());
+    if (used_ + n > buffer_.size())
+    {
+        flush();
+    }
+    uint8_t* p = buffer_.data() + used_;
+    used_ += n;
+    return p;
+}
+
+void EventWriter::flush()
+{
+    writeFully(fd_, buffer_.data(), used_, filename_);
+    used_ = 0;
+}
+
+void EventWriter::write(const Event& e)
+{
+    if (e.hits.size() > std::numeric_limits<uint8_t>::max())
+    {
+        throw std::runtime_error("EventWriter::write - " + filename_ + ": event with " +
+                                 std::to_string(e.hits.size()) + " hits can't be written");
+    }
+
+    uint8_t* p = reserve(EventView::sizeOf(e.hits.size()));
+    p          = store(p, static_cast<uint8_t>(e.hits.size()));
+    p          = store(p, e.trigger_id);
+    for (const auto& hit : e.hits)
+    {
+        p = store(p, hit.id);
+        p = store(p, hit.timestamp);
+        p = store(p, hit.adc);
+    }
+    ++events_;
+}
+
+void EventWriter::write(const EventView& view)
+{
+    std::memcpy(reserve(view.size()), view.data(), view.size());
+    ++events_;
+}
+
+void EventWriter::close()
+{
+    if (fd_ == -1)
+    {
+        return;
+    }
+
+    const int fd = fd_;
+    fd_          = -1;
+    try
+    {
+        writeFully(fd, buffer_.data(), used_, filename_);
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+    used_ = 0;
+
+    const off_t count_offset = offsetof(EventHeader, event_count);
+    if (pwrite(fd, &events_, sizeof(events_), count_offset) != sizeof(events_))
+    {
+        const int errnum = errno;
+        ::close(fd);
+        throw std::runtime_error("EventWriter::close - failed to write header of " + filename_ + " (" +
+                                 FSUtils::getErrorDescription(errnum) + ")");
+    }
+    if (::close(fd) == -1 && errno != EINTR)
+    {
+        throw std::runtime_error("EventWriter::close - failed to close " + filename_ + " (" +
+                                 FSUtils::getErrorDescription(errno) + ")");
+    }
+}
+
+} // namespace SOCO
@@ -0,0 +1,76 @@
+#ifndef SOCO_EVENTWRITER_HH
+#define SOCO_EVENTWRITER_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string>
+#include <vector>
+
+#include "Event.h"
+#include "EventView.h"
+
+namespace SOCO
+{
+
+// Writes complete soco2 event files: header, metadata blocks, data magic and events
+// Events are serialised into a large buffer that is written in big chunks. The event count in
+// the header is filled in by close(). Existing files are only replaced with overwrite, so raw data
+// is never destroyed by accident.
+class EventWriter
+{
+    public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 16 << 20;
+
+    explicit EventWriter(const std::string& filename,
+                         const std::vector<std::string>& metadata = std::vector<std::string>(),
+                         size_t buffer_size                      = DEFAULT_BUFFER_SIZE,
+                         bool overwrite                          = false);
+    ~EventWriter();
+
+    // NonCopyable
+    EventWriter(const EventWriter&) = delete;
+    EventWriter& operator=(const EventWriter&) = delete;
+
+    void write(const Event& e);
+
+    // Copies the raw event data
+    void write(const EventView& view);
+
+    // Writes the remaining buffer and the event count, further writes are not possible
+    void close();
+
+    uint64_t eventsWritten() const { return events_; }
+
+    const std::string& getFilename() const { return filename_; }
+
+    private:
+    uint8_t* reserve(size_t n);
+    void flush();
+
+    std::string filename_;
+    int fd_;
+    std::vector<uint8_t> buffer_;
+    size_t used_;
+    uint64_t events_;
+};
+
+} // namespace SOCO
+
+#endif // SOCO_EVENTWRITER_HH
@@ -1,6 +1,7 @@
 #include "FSUtils.h"
 
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 
 #include <algorithm>
@@ -517,6 +518,19 @@ std::string FSUtils::getHomeDirectory()
     return std::string(pwd.pw_dir);
 }
 
+std::string FSUtils::realpath(const std::string& path)
+{
+    assert(!path.empty());
+    char resolved[PATH_MAX];
+    errno = 0;
+    if (!::realpath(path.c_str(), resolved))
+    {
+        int errnum = errno;
+        throw std::runtime_error("Failed to resolve " + path + " (" + getErrorDescription(errnum) + ")");
+    }
+    return std::string(resolved);
+}
+
 std::string FSUtils::getcwd()
 {
     char path[PATH_MAX];
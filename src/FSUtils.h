@@ -78,6 +78,9 @@ class FSUtils
 
     static std::string getcwd();
 
+    // Absolute path without symlinks, "." and "..", the file must exist
+    static std::string realpath(const std::string& path);
+
     static bool isRemoteOrSharedFS(const std::string& path);
 };
 
@@ -0,0 +1,263 @@
+#include "FileStream.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FSUtils.h"
+
+namespace SOCO
+{
+
+constexpr size_t FileStream::ALIGNMENT;
+constexpr size_t FileStream::HEADROOM;
+constexpr size_t FileStream::BUFFERS;
+constexpr size_t FileStream::MIN_BUFFER;
+
+FileStream::FileStream(const std::string& filename, const size_t memory_limit, const uint64_t offset)
+    : filename_{filename}
+    , fd_{-1}
+    , file_size_{0}
+    , buffer_size_{std::max(MIN_BUFFER, (memory_limit / BUFFERS) & ~(ALIGNMENT - 1))}
+    , blocks_{}
+    , spill_{}
+    , cur_{nullptr}
+    , end_{nullptr}
+    , end_offset_{offset & ~static_cast<uint64_t>(ALIGNMENT - 1)}
+    , next_slot_{0}
+    , held_slot_{0}
+    , has_slot_{false}
+    , at_eof_{false}
+    , wait_seconds_{0}
+    , read_offset_{end_offset_}
+    , stop_{false}
+{
+    struct stat sb;
+    FSUtils::stat(filename_, &sb);
+    if (!S_ISREG(sb.st_mode))
+    {
+        throw std::runtime_error("FileStream - " + filename_ + " is not a regular file");
+    }
+    file_size_ = sb.st_size;
+
+    fd_ = open(filename_.c_str(), O_RDONLY | O_DIRECT);
+    if (fd_ == -1)
+    {
+        // try opening file without O_DIRECT, may be unsupported
+        fd_ = open(filename_.c_str(), O_RDONLY);
+    }
+    if (fd_ == -1)
+    {
+        throw std::runtime_error("FileStream - can't open " + filename_ + ": " +
+                                 FSUtils::getErrorDescription(errno));
+    }
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    blocks_.resize(BUFFERS);
+    for (auto& block : blocks_)
+    {
+        void* memory = nullptr;
+        if (posix_memalign(&memory, ALIGNMENT, HEADROOM + buffer_size_) != 0)
+        {
+            for (auto& b : blocks_)
+            {
+                free(b.memory);
+            }
+            close(fd_);
+            throw std::runtime_error("FileStream - failed to allocate buffers for " + filename_);
+        }
+        block = Block{static_cast<uint8_t*>(memory), 0, false, false, 0};
+    }
+
+    reader_ = std::thread(&FileStream::readAhead, this);
+
+    // the first block starts at the aligned offset below the requested one
+    const size_t skip = static_cast<size_t>(offset - end_offset_);
+    if (require(skip))
+    {
+        consume(skip);
+    }
+}
+
+FileStream::~FileStream()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    freed_.notify_all();
+    reader_.join();
+
+    for (auto& block : blocks_)
+    {
+        free(block.memory);
+    }
+    while (close(fd_) == -1 && errno == EINTR)
+        ;
+}
+
+bool FileStream::require(const size_t n)
+{
+    while (available() < n)
+    {
+        if (at_eof_)
+        {
+            return false;
+        }
+        nextBlock();
+    }
+    return true;
+}
+
+void FileStream::consume(const size_t n)
+{
+    assert(n <= available());
+    cur_ += n;
+}
+
+bool FileStream::nextBlock()
+{
+    const size_t slot = next_slot_;
+    Block& block      = blocks_[slot];
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!block.filled)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            filled_.wait(lock, [&block]() { return block.filled; });
+            wait_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+    if (block.error)
+    {
+        throw std::runtime_error("FileStream - failed to read " + filename_ + ": " +
+                                 FSUtils::getErrorDescription(block.error));
+    }
+    next_slot_ = (next_slot_ + 1) % blocks_.size();
+    at_eof_    = block.eof;
+
+    const size_t leftover = available();
+    uint8_t* data         = block.memory + HEADROOM;
+    if (leftover <= HEADROOM)
+    {
+        // common case: the unconsumed tail (e.g. a partial event) fits in front of the new block
+        if (leftover)
+        {
+            std::memcpy(data - leftover, cur_, leftover);
+        }
+        if (has_slot_)
+        {
+            release(held_slot_);
+        }
+        held_slot_ = slot;
+        has_slot_  = true;
+        cur_       = data - leftover;
+        end_       = data + block.size;
+    }
+    else
+    {
+        // large metadata blocks spanning several buffers are assembled on the heap
+        std::vector<uint8_t> spill;
+        spill.reserve(leftover + block.size);
+        spill.insert(spill.end(), cur_, end_);
+        spill.insert(spill.end(), data, data + block.size);
+        if (has_slot_)
+        {
+            release(held_slot_);
+        }
+        release(slot);
+        has_slot_ = false;
+        spill_.swap(spill);
+        cur_ = spill_.data();
+        end_ = cur_ + spill_.size();
+    }
+    end_offset_ += block.size;
+    return true;
+}
+
+void FileStream::release(const size_t slot)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        blocks_[slot].filled = false;
+    }
+    freed_.notify_one();
+}
+
+void FileStream::readAhead()
+{
+    size_t slot = 0;
+    for (;;)
+    {
+        Block& block = blocks_[slot];
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            freed_.wait(lock, [&]() { return stop_ || !block.filled; });
+            if (stop_)
+            {
+                return;
+            }
+        }
+
+        int error       = 0;
+        const size_t n  = readFully(block.memory + HEADROOM, buffer_size_, read_offset_, error);
+        read_offset_   += n;
+        const bool last = (error || n < buffer_size_ || read_offset_ >= file_size_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            block.size   = n;
+            block.eof    = last;
+            block.error  = error;
+            block.filled = true;
+        }
+        filled_.notify_one();
+
+        if (last)
+        {
+            return;
+        }
+        slot = (slot + 1) % blocks_.size();
+    }
+}
+
+size_t FileStream::readFully(uint8_t* buffer, const size_t size, const uint64_t offset, int& error)
+{
+    size_t done = 0;
+    while (done < size && offset + done < file_size_)
+    {
+        const ssize_t rc = pread(fd_, buffer + done, size - done, offset + done);
+        if (rc == -1)
+        {
+            const int errnum = errno;
+            if (errnum == EINTR)
+            {
+                continue;
+            }
+            const int flags = fcntl(fd_, F_GETFL);
+            if (errnum == EINVAL && flags != -1 && (flags & O_DIRECT))
+            {
+                // O_DIRECT is not supported for this file (or the unaligned tail), read buffered
+                fcntl(fd_, F_SETFL, flags & ~O_DIRECT);
+                continue;
+            }
+            error = errnum;
+            break;
+        }
+        if (rc == 0)
+        {
+            break;
+        }
+        done += static_cast<size_t>(rc);
+    }
+    return done;
+}
+
+} // namespace SOCO
@@ -0,0 +1,113 @@
+#ifndef SOCO_FILESTREAM_HH
+#define SOCO_FILESTREAM_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SOCO
+{
+
+// Sequential reader with bounded memory
+// A background thread reads ahead into a fixed ring of aligned buffers. Data that spans two
+// buffers is made contiguous by copying the tail of the old buffer in front of the new one.
+class FileStream
+{
+    public:
+    static constexpr size_t ALIGNMENT   = 4096;
+    static constexpr size_t HEADROOM    = 4096;
+    static constexpr size_t BUFFERS     = 4;
+    static constexpr size_t MIN_BUFFER  = 16 * ALIGNMENT;
+
+    // Uses at most about memory_limit bytes for buffers, starts reading at offset
+    FileStream(const std::string& filename, size_t memory_limit, uint64_t offset = 0);
+    ~FileStream();
+
+    // NonCopyable
+    FileStream(const FileStream&) = delete;
+    FileStream& operator=(const FileStream&) = delete;
+
+    // Makes at least n bytes available at data(), returns false if the file ends before
+    bool require(size_t n);
+
+    const uint8_t* data() const { return cur_; }
+
+    size_t available() const { return static_cast<size_t>(end_ - cur_); }
+
+    void consume(size_t n);
+
+    // File offset of data()
+    uint64_t position() const { return end_offset_ - available(); }
+
+    uint64_t fileSize() const { return file_size_; }
+
+    // Time the consumer was blocked waiting for the read-ahead thread
+    double waitSeconds() const { return wait_seconds_; }
+
+    private:
+    struct Block
+    {
+        uint8_t* memory;
+        size_t size;
+        bool filled;
+        bool eof;
+        int error;
+    };
+
+    void readAhead();
+    bool nextBlock();
+    void release(size_t slot);
+    size_t readFully(uint8_t* buffer, size_t size, uint64_t offset, int& error);
+
+    std::string filename_;
+    int fd_;
+    uint64_t file_size_;
+    size_t buffer_size_;
+    std::vector<Block> blocks_;
+    std::vector<uint8_t> spill_;
+
+    // consumer state
+    const uint8_t* cur_;
+    const uint8_t* end_;
+    uint64_t end_offset_;
+    size_t next_slot_;
+    size_t held_slot_;
+    bool has_slot_;
+    bool at_eof_;
+    double wait_seconds_;
+
+    // producer state
+    uint64_t read_offset_;
+    bool stop_;
+    std::mutex mutex_;
+    std::condition_variable filled_;
+    std::condition_variable freed_;
+    std::thread reader_;
+};
+
+} // namespace SOCO
+
+#endif // SOCO_FILESTREAM_HH
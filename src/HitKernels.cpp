@@ -0,0 +1,172 @@
+#include "HitKernels.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "EventView.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SOCO_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define SOCO_X86_KERNELS 0
+#endif
+
+namespace SOCO
+{
+
+void deinterleaveHitsScalar(const uint8_t* src,
+                            const size_t n,
+                            size_t /*readable*/,
+                            uint16_t* ids,
+                            uint16_t* adcs,
+                            uint64_t* timestamps)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        const HitView hit(src + i * HIT_SIZE);
+        ids[i]        = hit.id();
+        adcs[i]       = hit.adc();
+        timestamps[i] = hit.timestamp();
+    }
+}
+
+#if SOCO_X86_KERNELS
+
+namespace
+{
+
+// 4 records per iteration: each 16 byte load starts at a record, so bytes 0-1 are the id,
+// 2-9 the timestamp and 10-11 the adc
+__attribute__((target("ssse3"))) void deinterleaveHitsSSSE3(const uint8_t* src,
+                                                             const size_t n,
+                                                             const size_t readable,
+                                                             uint16_t* ids,
+                                                             uint16_t* adcs,
+                                                             uint64_t* timestamps)
+{
+    const __m128i id_adc = _mm_setr_epi8(0, 1, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i split  = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+
+    size_t i = 0;
+    for (; i + 4 <= n && i * HIT_SIZE + 3 * HIT_SIZE + 16 <= readable; i += 4)
+    {
+        const uint8_t* p = src + i * HIT_SIZE;
+        const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + HIT_SIZE));
+        const __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2 * HIT_SIZE));
+        const __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 3 * HIT_SIZE));
+
+        const __m128i t01 = _mm_unpacklo_epi64(_mm_srli_si128(r0, 2), _mm_srli_si128(r1, 2));
+        const __m128i t23 = _mm_unpacklo_epi64(_mm_srli_si128(r2, 2), _mm_srli_si128(r3, 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(timestamps + i), t01);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(timestamps + i + 2), t23);
+
+        // (id, adc) pairs of all 4 records, then all ids in the low and all adcs in the high half
+        const __m128i p01   = _mm_unpacklo_epi32(_mm_shuffle_epi8(r0, id_adc), _mm_shuffle_epi8(r1, id_adc));
+        const __m128i p23   = _mm_unpacklo_epi32(_mm_shuffle_epi8(r2, id_adc), _mm_shuffle_epi8(r3, id_adc));
+        const __m128i pairs = _mm_shuffle_epi8(_mm_unpacklo_epi64(p01, p23), split);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(ids + i), pairs);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(adcs + i), _mm_srli_si128(pairs, 8));
+    }
+    deinterleaveHitsScalar(src + i * HIT_SIZE, n - i, 0, ids + i, adcs + i, timestamps + i);
+}
+
+// Same as the SSSE3 kernel with 8 records per iteration, records k and k + 4 share a register
+__attribute__((target("avx2"))) void deinterleaveHitsAVX2(const uint8_t* src,
+                                                           const size_t n,
+                                                           const size_t readable,
+                                                           uint16_t* ids,
+                                                           uint16_t* adcs,
+                                                           uint64_t* timestamps)
+{
+    const __m256i id_adc = _mm256_setr_epi8(0, 1, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                            0, 1, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i split  = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15,
+                                            0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+
+    size_t i = 0;
+    for (; i + 8 <= n && i * HIT_SIZE + 7 * HIT_SIZE + 16 <= readable; i += 8)
+    {
+        const uint8_t* p = src + i * HIT_SIZE;
+        __m256i r[4];
+        for (size_t k = 0; k < 4; ++k)
+        {
+            const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + k * HIT_SIZE));
+            const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + (k + 4) * HIT_SIZE));
+            r[k]             = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        }
+
+        // lanes: [ts0 ts1 | ts4 ts5] and [ts2 ts3 | ts6 ts7]
+        const __m256i t01 = _mm256_unpacklo_epi64(_mm256_srli_si256(r[0], 2), _mm256_srli_si256(r[1], 2));
+        const __m256i t23 = _mm256_unpacklo_epi64(_mm256_srli_si256(r[2], 2), _mm256_srli_si256(r[3], 2));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(timestamps + i), _mm256_permute2x128_si256(t01, t23, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(timestamps + i + 4), _mm256_permute2x128_si256(t01, t23, 0x31));
+
+        // lanes: [ids 0-3, adcs 0-3 | ids 4-7, adcs 4-7], reordered to [ids 0-7 | adcs 0-7]
+        const __m256i p01 = _mm256_unpacklo_epi32(_mm256_shuffle_epi8(r[0], id_adc), _mm256_shuffle_epi8(r[1], id_adc));
+        const __m256i p23 = _mm256_unpacklo_epi32(_mm256_shuffle_epi8(r[2], id_adc), _mm256_shuffle_epi8(r[3], id_adc));
+        const __m256i pairs = _mm256_shuffle_epi8(_mm256_unpacklo_epi64(p01, p23), split);
+        const __m256i out   = _mm256_permute4x64_epi64(pairs, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ids + i), _mm256_castsi256_si128(out));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(adcs + i), _mm256_extracti128_si256(out, 1));
+    }
+    deinterleaveHitsSSSE3(src + i * HIT_SIZE, n - i, readable - i * HIT_SIZE, ids + i, adcs + i, timestamps + i);
+}
+
+} // namespace {anonymous}
+
+#endif /* SOCO_X86_KERNELS */
+
+namespace
+{
+
+struct Kernel
+{
+    DeinterleaveHitsFn function;
+    const char* name;
+};
+
+Kernel selectKernel()
+{
+    const char* env         = std::getenv("SOCO_SIMD");
+    const std::string limit = env ? env : "";
+#if SOCO_X86_KERNELS
+    __builtin_cpu_init();
+    if (limit != "scalar" && limit != "ssse3" && __builtin_cpu_supports("avx2"))
+    {
+        return Kernel{deinterleaveHitsAVX2, "avx2"};
+    }
+    if (limit != "scalar" && __builtin_cpu_supports("ssse3"))
+    {
+        return Kernel{deinterleaveHitsSSSE3, "ssse3"};
+    }
+#endif /* SOCO_X86_KERNELS */
+    return Kernel{deinterleaveHitsScalar, "scalar"};
+}
+
+const Kernel& kernel()
+{
+    static const Kernel selected = selectKernel();
+    return selected;
+}
+
+} // namespace {anonymous}
+
+void deinterleaveHits(const uint8_t* src,
+                      const size_t n,
+                      const size_t readable,
+                      uint16_t* ids,
+                      uint16_t* adcs,
+                      uint64_t* timestamps)
+{
+    kernel().function(src, n, readable, ids, adcs, timestamps);
+}
+
+const char* deinterleaveHitsKernel()
+{
+    return kernel().name;
+}
+
+} // namespace SOCO
@@ -0,0 +1,59 @@
+#ifndef SOCO_HITKERNELS_HH
+#define SOCO_HITKERNELS_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SOCO
+{
+
+// De-interleaves n packed hit records (see HIT_SIZE) at src into separate arrays
+// readable is the number of bytes after src that may be read, at least n * HIT_SIZE.
+// The SIMD kernels use 16 byte loads and fall back to scalar code near the end of readable data.
+using DeinterleaveHitsFn = void (*)(const uint8_t* src,
+                                    size_t n,
+                                    size_t readable,
+                                    uint16_t* ids,
+                                    uint16_t* adcs,
+                                    uint64_t* timestamps);
+
+void deinterleaveHitsScalar(const uint8_t* src,
+                            size_t n,
+                            size_t readable,
+                            uint16_t* ids,
+                            uint16_t* adcs,
+                            uint64_t* timestamps);
+
+// Best kernel for the running CPU (AVX2, SSSE3 or scalar), selected once at runtime
+// The environment variable SOCO_SIMD=avx2|ssse3|scalar restricts the selection
+void deinterleaveHits(const uint8_t* src,
+                      size_t n,
+                      size_t readable,
+                      uint16_t* ids,
+                      uint16_t* adcs,
+                      uint64_t* timestamps);
+
+const char* deinterleaveHitsKernel();
+
+} // namespace SOCO
+
+#endif // SOCO_HITKERNELS_HH
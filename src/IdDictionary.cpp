@@ -0,0 +1,76 @@
+#include "IdDictionary.h"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace SOCO
+{
+
+constexpr uint16_t IdDictionary::NO_INDEX;
+
+IdDictionary::IdDictionary()
+    : ids_()
+    , index_(65536, NO_INDEX)
+{
+}
+
+IdDictionary::IdDictionary(const std::string& ids)
+    : IdDictionary()
+{
+    std::bitset<65536> seen;
+    std::istringstream ss(ids);
+    unsigned long id;
+    while (ss >> id)
+    {
+        if (id > std::numeric_limits<uint16_t>::max())
+        {
+            throw std::runtime_error("IdDictionary - invalid id " + std::to_string(id));
+        }
+        seen[id] = true;
+    }
+    if (!ss.eof())
+    {
+        throw std::runtime_error("IdDictionary - invalid ids '" + ids + "'");
+    }
+    add(seen);
+}
+
+void IdDictionary::add(const uint16_t id)
+{
+    if (!contains(id))
+    {
+        std::bitset<65536> seen;
+        seen[id] = true;
+        add(seen);
+    }
+}
+
+void IdDictionary::add(const std::bitset<65536>& ids)
+{
+    std::bitset<65536> all = ids;
+    for (const uint16_t id : ids_)
+    {
+        all[id] = true;
+    }
+    ids_.clear();
+    for (size_t id = 0; id < all.size(); ++id)
+    {
+        if (all[id])
+        {
+            index_[id] = static_cast<uint16_t>(ids_.size());
+            ids_.push_back(static_cast<uint16_t>(id));
+        }
+    }
+}
+
+std::string IdDictionary::toString() const
+{
+    std::string result;
+    for (const uint16_t id : ids_)
+    {
+        result += (result.empty() ? "" : " ") + std::to_string(id);
+    }
+    return result;
+}
+
+} // namespace SOCO
@@ -0,0 +1,70 @@
+#ifndef SOCO_IDDICTIONARY_HH
+#define SOCO_IDDICTIONARY_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace SOCO
+{
+
+// Dense index of the sparse detector ids: the ids in increasing order get the indices 0, 1, 2, ...
+// soco2root stores the ids of each tree as TNamed "ids" in its UserInfo, see toString, e.g.
+// SOCO::IdDictionary ids(ttree->GetUserInfo()->FindObject("ids")->GetTitle());
+class IdDictionary
+{
+    public:
+    // Index of ids that are not part of the dictionary
+    static constexpr uint16_t NO_INDEX = std::numeric_limits<uint16_t>::max();
+
+    IdDictionary();
+
+    // Ids separated by spaces, as returned by toString
+    explicit IdDictionary(const std::string& ids);
+
+    // The indices of larger ids change when a new id is added
+    void add(uint16_t id);
+    void add(const std::bitset<65536>& ids);
+
+    size_t size() const { return ids_.size(); }
+
+    bool contains(const uint16_t id) const { return index_[id] != NO_INDEX; }
+
+    uint16_t id(const size_t index) const { return ids_[index]; }
+
+    uint16_t index(const uint16_t id) const { return index_[id]; }
+
+    const std::vector<uint16_t>& ids() const { return ids_; }
+
+    std::string toString() const;
+
+    private:
+    std::vector<uint16_t> ids_;
+    std::vector<uint16_t> index_;
+};
+
+} // namespace SOCO
+
+#endif // SOCO_IDDICTIONARY_HH
@@ -0,0 +1,223 @@
+#include "Manifest.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Event.h"
+#include "FSUtils.h"
+
+namespace
+{
+
+// Version 1 had no options digest, its entries are ignored, so all files are converted again
+const std::string MANIFEST_VERSION   = "# soco2root manifest 2";
+const std::string MANIFEST_VERSION_1 = "# soco2root manifest 1";
+const uint64_t FNV_OFFSET_BASIS      = UINT64_C(0xcbf29ce484222325);
+
+uint64_t fnv1a(const uint8_t* data, const size_t size, uint64_t hash)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+// Reads up to size bytes at offset, returns the number of bytes read
+size_t readAt(const int fd, uint8_t* buffer, const size_t size, const off_t offset)
+{
+    size_t done = 0;
+    while (done < size)
+    {
+        const ssize_t n = pread(fd, buffer + done, size - done, offset + static_cast<off_t>(done));
+        if (n == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return done;
+}
+
+// The same output file for any spelling of its path, e.g. "./run.root" and "run.root"
+std::string normalizeOutput(const std::string& output)
+{
+    const std::string dir = SOCO::FSUtils::dirname(output);
+    if (!SOCO::FSUtils::directoryExists(dir))
+    {
+        return output;
+    }
+    return SOCO::FSUtils::collapseDuplicateSlashes(SOCO::FSUtils::realpath(dir) + "/" +
+                                                   SOCO::FSUtils::basename(output));
+}
+
+} // namespace {anonymous}
+
+constexpr size_t ManifestEntry::CHECKSUM_BYTES;
+
+ManifestEntry ManifestEntry::describe(const std::string& input, const std::string& output, const uint64_t options)
+{
+    ManifestEntry entry;
+    entry.input   = SOCO::FSUtils::realpath(input);
+    entry.output  = normalizeOutput(output);
+    entry.options = options;
+
+    struct stat sb;
+    SOCO::FSUtils::stat(input, &sb);
+    entry.size     = static_cast<uint64_t>(sb.st_size);
+    entry.mtime_ns = static_cast<int64_t>(sb.st_mtim.tv_sec) * 1000000000 + sb.st_mtim.tv_nsec;
+
+    const int fd = open(input.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        throw std::runtime_error("ManifestEntry::describe - can't open " + input + ": " + strerror(errno));
+    }
+    std::vector<uint8_t> buffer(CHECKSUM_BYTES);
+    size_t n = readAt(fd, buffer.data(), buffer.size(), 0);
+    if (n >= sizeof(SOCO::EventHeader))
+    {
+        SOCO::EventHeader header;
+        std::memcpy(&header, buffer.data(), sizeof(header));
+        entry.event_count = header.event_count;
+    }
+    uint64_t hash = fnv1a(buffer.data(), n, FNV_OFFSET_BASIS);
+    if (entry.size > CHECKSUM_BYTES)
+    {
+        const uint64_t tail = std::max<uint64_t>(entry.size - CHECKSUM_BYTES, CHECKSUM_BYTES);
+        n                   = readAt(fd, buffer.data(), static_cast<size_t>(entry.size - tail), static_cast<off_t>(tail));
+        hash                = fnv1a(buffer.data(), n, hash);
+    }
+    close(fd);
+    entry.checksum = hash;
+    return entry;
+}
+
+uint64_t ManifestEntry::digest(const std::string& text)
+{
+    return fnv1a(reinterpret_cast<const uint8_t*>(text.data()), text.size(), FNV_OFFSET_BASIS);
+}
+
+Manifest::Manifest(const std::string& file)
+    : filename(file)
+    , entries()
+    , mutex()
+{
+    std::ifstream in(filename);
+    if (!in)
+    {
+        return;
+    }
+
+    std::string line;
+    if (std::getline(in, line) && line == MANIFEST_VERSION_1)
+    {
+        return;
+    }
+    if (!in || line != MANIFEST_VERSION)
+    {
+        throw std::runtime_error("Manifest - " + filename + " is not a soco2root manifest");
+    }
+    // input, output, size, mtime, event count, checksum and options digest separated by tabs
+    while (std::getline(in, line))
+    {
+        std::istringstream fields(line);
+        ManifestEntry entry;
+        if (std::getline(fields, entry.input, '\t') && std::getline(fields, entry.output, '\t') &&
+            (fields >> entry.size >> entry.mtime_ns >> entry.event_count >> std::hex >> entry.checksum >>
+             entry.options))
+        {
+            entries[entry.input] = entry;
+        }
+    }
+}
+
+std::string Manifest::filenameFor(const std::string& directory)
+{
+    return SOCO::FSUtils::collapseDuplicateSlashes(directory + "/.soco2root.manifest");
+}
+
+std::string Manifest::needsConversion(const ManifestEntry& current) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = entries.find(current.input);
+    if (it == entries.end())
+    {
+        return "new file";
+    }
+    const ManifestEntry& last = it->second;
+    if (last.output != current.output)
+    {
+        return "different output " + current.output;
+    }
+    if (last.options != current.options)
+    {
+        return "different options";
+    }
+    if (!SOCO::FSUtils::fileExists(current.output))
+    {
+        return "output missing";
+    }
+    if (last.size != current.size)
+    {
+        return "size changed";
+    }
+    if (last.event_count != current.event_count)
+    {
+        return "event count changed";
+    }
+    if (last.checksum != current.checksum)
+    {
+        return "contents changed";
+    }
+    if (last.mtime_ns != current.mtime_ns)
+    {
+        return "modified";
+    }
+    return "";
+}
+
+void Manifest::update(const ManifestEntry& entry)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[entry.input] = entry;
+    save();
+}
+
+void Manifest::save() const
+{
+    // replace atomically, an interrupted run must not leave a broken manifest
+    const std::string temporary = filename + ".tmp";
+    {
+        std::ofstream out(temporary);
+        out << MANIFEST_VERSION << "\n";
+        for (const auto& it : entries)
+        {
+            const ManifestEntry& e = it.second;
+            out << e.input << '\t' << e.output << '\t' << e.size << ' ' << e.mtime_ns << ' ' << e.event_count
+                << ' ' << std::hex << e.checksum << ' ' << e.options << std::dec << '\n';
+        }
+        if (!out)
+        {
+            throw std::runtime_error("Manifest::save - can't write " + temporary);
+        }
+    }
+    if (std::rename(temporary.c_str(), filename.c_str()) == -1)
+    {
+        throw std::runtime_error("Manifest::save - can't replace " + filename + ": " + strerror(errno));
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef SOCO2ROOT_MANIFEST_H
+#define SOCO2ROOT_MANIFEST_H
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+// State of an input file and the options at the time it was converted
+struct ManifestEntry
+{
+    std::string input; // absolute path, see SOCO::FSUtils::realpath
+    std::string output;
+    uint64_t size        = 0;
+    int64_t mtime_ns     = 0;
+    uint64_t event_count = 0; // from the file header
+    uint64_t checksum    = 0; // FNV-1a of the first and last CHECKSUM_BYTES of the file
+    uint64_t options     = 0; // digest of the options that change the output
+
+    static constexpr size_t CHECKSUM_BYTES = 4096;
+
+    // Reads the current state of input, only the header and tail are read
+    // options: digest of the options the output is written with, see digest
+    static ManifestEntry describe(const std::string& input, const std::string& output, uint64_t options);
+
+    // FNV-1a of text, e.g. of all output options and their values
+    static uint64_t digest(const std::string& text);
+};
+
+// Record of converted files for incremental conversion, stored as text file in the output directory
+// Thread safe
+class Manifest
+{
+    public:
+    // Loads filename if it exists
+    explicit Manifest(const std::string& filename);
+
+    // NonCopyable
+    Manifest(const Manifest&) = delete;
+    Manifest& operator=(const Manifest&) = delete;
+
+    // Manifest for the outputs in directory
+    static std::string filenameFor(const std::string& directory);
+
+    // Empty if input was converted to output before and has not changed since, otherwise the reason
+    // why it has to be converted
+    std::string needsConversion(const ManifestEntry& current) const;
+
+    // Records a successful conversion and saves the manifest
+    void update(const ManifestEntry& entry);
+
+    const std::string& getFilename() const { return filename; }
+
+    private:
+    void save() const;
+
+    std::string filename;
+    std::map<std::string, ManifestEntry> entries;
+    mutable std::mutex mutex;
+};
+
+#endif // SOCO2ROOT_MANIFEST_H
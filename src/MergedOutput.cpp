@@ -0,0 +1,208 @@
+#include "MergedOutput.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+#include "TFileMerger.h"
+#include "TMemFile.h"
+
+#include "FSUtils.h"
+
+namespace
+{
+
+struct PartKey
+{
+    std::string name;
+    bool numbered;
+    std::string number; // without leading zeros
+
+    explicit PartKey(const std::string& path)
+        : name(SOCO::FSUtils::stripExtension(path))
+        , numbered(SOCO::FSUtils::isNumericPostfix(name))
+        , number()
+    {
+        if (numbered)
+        {
+            const size_t last_dot = name.find_last_of('.');
+            number                = name.substr(last_dot + 1);
+            name.erase(last_dot);
+            number.erase(0, std::min(number.find_first_not_of('0'), number.size()));
+        }
+    }
+
+    bool operator<(const PartKey& rhs) const
+    {
+        // numbers of any length, compared by number of digits first
+        return std::make_tuple(name, numbered, number.size(), number) <
+               std::make_tuple(rhs.name, rhs.numbered, rhs.number.size(), rhs.number);
+    }
+};
+
+} // namespace {anonymous}
+
+MergedOutput::MergedOutput(const std::string& out,
+                           const Soco2RootOptions& opts,
+                           const size_t nthreads,
+                           const size_t buffered)
+    : output(out)
+    , options(opts)
+    , threads(std::max<size_t>(nthreads, 1))
+    , max_buffered(std::max(buffered, threads))
+    , stats()
+{
+    if (options.chunks > 1)
+    {
+        throw std::runtime_error("MergedOutput - chunks can't be combined with a merged output");
+    }
+}
+
+std::vector<std::string> MergedOutput::sortParts(std::vector<std::string> files)
+{
+    std::stable_sort(files.begin(), files.end(), [](const std::string& a, const std::string& b) {
+        return PartKey(a) < PartKey(b);
+    });
+    return files;
+}
+
+void MergedOutput::process(const std::vector<std::string>& files)
+{
+    const std::vector<std::string> parts = sortParts(files);
+    stats.assign(parts.size(), ConversionStats());
+
+    // the index of each hit needs one dictionary for all parts first
+    if (options.id_index && !options.id_dictionary)
+    {
+        options.id_dictionary = Soco2Root::scanIds(parts, options);
+    }
+
+    // shared state, guarded by mutex
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::vector<char>> images(parts.size());
+    std::vector<bool> ready(parts.size(), false);
+    SeenIds seen;
+    size_t next_part = 0;
+    size_t merged    = 0;
+    std::exception_ptr error;
+
+    auto fail = [&](std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error)
+        {
+            error = e;
+        }
+        changed.notify_all();
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < std::min(threads, parts.size()); ++w)
+    {
+        workers.emplace_back([&]() {
+            for (;;)
+            {
+                size_t i;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    // bounded memory: don't start parts too far ahead of the merge
+                    changed.wait(lock, [&]() {
+                        return error || next_part >= parts.size() || next_part < merged + max_buffered;
+                    });
+                    if (error || next_part >= parts.size())
+                    {
+                        return;
+                    }
+                    i = next_part++;
+                }
+
+                try
+                {
+                    Soco2Root s2r(parts[i], output, options);
+                    std::vector<char> image = s2r.processToMemory();
+                    stats[i]                = s2r.getStats();
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    for (const auto& tree_ids : s2r.getSeenIds())
+                    {
+                        seen[tree_ids.first] |= tree_ids.second;
+                    }
+                    images[i].swap(image);
+                    ready[i] = true;
+                    changed.notify_all();
+                }
+                catch (...)
+                {
+                    fail(std::current_exception());
+                    return;
+                }
+            }
+        });
+    }
+
+    // Append the parts to the output in order, while the workers convert the next ones
+    try
+    {
+        TDirectory::TContext context;
+        TFileMerger merger(false, false);
+        merger.SetFastMethod(true);
+        bool ok = (options.compressionSettings() >= 0)
+                      ? merger.OutputFile(output.c_str(), "RECREATE", options.compressionSettings())
+                      : merger.OutputFile(output.c_str(), "RECREATE");
+        if (!ok)
+        {
+            throw std::runtime_error("MergedOutput::process - can't create " + output);
+        }
+
+        for (size_t i = 0; i < parts.size(); ++i)
+        {
+            std::vector<char> image;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() { return error || ready[i]; });
+                if (error)
+                {
+                    break;
+                }
+                image.swap(images[i]);
+            }
+
+            // the memory file keeps its own copy of the image and is deleted by the merger
+            merger.AddAdoptFile(new TMemFile(parts[i].c_str(), image.data(), image.size(), "READ"));
+            image = std::vector<char>();
+            if (!merger.PartialMerge(TFileMerger::kIncremental | TFileMerger::kAll))
+            {
+                throw std::runtime_error("MergedOutput::process - failed to merge " + parts[i] + " into " + output);
+            }
+            merger.Reset();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            ++merged;
+            changed.notify_all();
+        }
+    }
+    catch (...)
+    {
+        fail(std::current_exception());
+    }
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    // without a dictionary, the merged trees only have the ids of the part they were created from
+    if (!options.id_dictionary)
+    {
+        Soco2Root::storeIds(output, seen);
+    }
+    std::cout << parts.size() << " files merged into " << output << std::endl;
+}
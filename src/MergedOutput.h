@@ -0,0 +1,59 @@
+#ifndef SOCO2ROOT_MERGEDOUTPUT_H
+#define SOCO2ROOT_MERGEDOUTPUT_H
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "ConversionStats.h"
+#include "Soco2Root.h"
+
+// Converts many parts of a run into a single ROOT file
+// Worker threads convert the parts into ROOT files in memory, which are appended to the output in
+// part order. At most max_buffered parts are converted or waiting to be merged at any time.
+class MergedOutput
+{
+    public:
+    MergedOutput(const std::string& output, const Soco2RootOptions& options, size_t threads, size_t max_buffered);
+
+    // NonCopyable
+    MergedOutput(const MergedOutput&) = delete;
+    MergedOutput& operator=(const MergedOutput&) = delete;
+
+    void process(const std::vector<std::string>& files);
+
+    // Statistics of the parts in part order, available after process
+    const std::vector<ConversionStats>& getStats() const { return stats; }
+
+    // Sorts run.0002.evt before run.0010.evt: by name without the numeric postfix, then by
+    // part number. Files without part number come first.
+    static std::vector<std::string> sortParts(std::vector<std::string> files);
+
+    private:
+    std::string output;
+    Soco2RootOptions options;
+    size_t threads;
+    size_t max_buffered;
+    std::vector<ConversionStats> stats;
+};
+
+#endif // SOCO2ROOT_MERGEDOUTPUT_H
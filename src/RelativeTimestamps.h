@@ -0,0 +1,94 @@
+#ifndef SOCO_RELATIVETIMESTAMPS_HH
+#define SOCO_RELATIVETIMESTAMPS_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace SOCO
+{
+
+// Hit timestamps relative to the event timestamp, as written with the relative output layout
+// Each hit stores dt = timestamp - event timestamp as int32. Hits where dt does not fit, e.g. in
+// events without a trigger hit (event timestamp 0), store ESCAPED_TIMESTAMP instead, and their
+// absolute timestamps are stored in order in a separate array.
+// In a tree of the relative layout, the absolute timestamps of an entry are rebuilt with
+//   decodeTimestamps(timestamp, hit_dt, mult, hit_ts_escaped, hit_ts);
+constexpr int32_t ESCAPED_TIMESTAMP = std::numeric_limits<int32_t>::min();
+
+// Timestamp, Escaped: unsigned 64 bit types, e.g. uint64_t or ULong64_t of ROOT
+// Returns the number of escaped timestamps written to escaped, at most n
+template <class Timestamp, class Escaped>
+size_t encodeTimestamps(const uint64_t event_timestamp,
+                        const Timestamp* timestamps,
+                        const size_t n,
+                        int32_t* dt,
+                        Escaped* escaped)
+{
+    static_assert(sizeof(Escaped) == sizeof(uint64_t) && !std::numeric_limits<Escaped>::is_signed,
+                  "timestamps are unsigned 64 bit");
+    size_t n_escaped = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        // two's complement difference, valid in both directions
+        const int64_t diff = static_cast<int64_t>(timestamps[i] - event_timestamp);
+        if (diff > std::numeric_limits<int32_t>::max() || diff <= ESCAPED_TIMESTAMP)
+        {
+            dt[i]                = ESCAPED_TIMESTAMP;
+            escaped[n_escaped++] = timestamps[i];
+        }
+        else
+        {
+            dt[i] = static_cast<int32_t>(diff);
+        }
+    }
+    return n_escaped;
+}
+
+// Inverse of encodeTimestamps, returns the number of escaped timestamps used
+template <class Escaped, class Timestamp>
+size_t decodeTimestamps(const uint64_t event_timestamp,
+                        const int32_t* dt,
+                        const size_t n,
+                        const Escaped* escaped,
+                        Timestamp* timestamps)
+{
+    static_assert(sizeof(Timestamp) == sizeof(uint64_t) && !std::numeric_limits<Timestamp>::is_signed,
+                  "timestamps are unsigned 64 bit");
+    size_t n_escaped = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (dt[i] == ESCAPED_TIMESTAMP)
+        {
+            timestamps[i] = escaped[n_escaped++];
+        }
+        else
+        {
+            timestamps[i] = event_timestamp + static_cast<uint64_t>(static_cast<int64_t>(dt[i]));
+        }
+    }
+    return n_escaped;
+}
+
+} // namespace SOCO
+
+#endif // SOCO_RELATIVETIMESTAMPS_HH
@@ -0,0 +1,114 @@
+#ifndef SOCO_SPSCQUEUE_HH
+#define SOCO_SPSCQUEUE_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace SOCO
+{
+
+// Bounded lock-free queue for exactly one producer and one consumer thread
+// push and pop never block, they return false if the queue is full or empty.
+template <class T>
+class SPSCQueue
+{
+    public:
+    explicit SPSCQueue(const size_t capacity)
+        : slots_(capacity + 1)
+        , head_{0}
+        , tail_{0}
+    {
+    }
+
+    // NonCopyable
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    // Producer only
+    bool push(const T& value)
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t next = increment(tail);
+        if (next == head_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        slots_[tail] = value;
+        tail_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only
+    bool pop(T& value)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        value = slots_[head];
+        head_.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+    private:
+    size_t increment(const size_t i) const { return (i + 1 == slots_.size()) ? 0 : i + 1; }
+
+    std::vector<T> slots_;
+    // on separate cache lines, written by the consumer and the producer respectively
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+};
+
+// Waits for a lock-free queue: spins briefly, then yields, then sleeps
+class Backoff
+{
+    public:
+    void operator()()
+    {
+        if (count_ < 64)
+        {
+            ++count_;
+        }
+        else if (count_ < 128)
+        {
+            ++count_;
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    void reset() { count_ = 0; }
+
+    private:
+    unsigned count_ = 0;
+};
+
+} // namespace SOCO
+
+#endif // SOCO_SPSCQUEUE_HH
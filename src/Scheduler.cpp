@@ -0,0 +1,114 @@
+#include "Scheduler.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+#include "FSUtils.h"
+
+SchedulePolicy parseSchedulePolicy(const std::string& name)
+{
+    if (name == "fifo")
+    {
+        return SchedulePolicy::FIFO;
+    }
+    if (name == "lpt")
+    {
+        return SchedulePolicy::LPT;
+    }
+    throw std::runtime_error("Unknown schedule '" + name + "', use 'fifo' or 'lpt'");
+}
+
+Scheduler::Scheduler(const std::vector<std::string>& files,
+                     const size_t threads,
+                     const SchedulePolicy policy,
+                     const bool work_stealing)
+    : sizes_(files.size())
+    , total_bytes_{0}
+    , expected_makespan_{0}
+    , threads_{std::max<size_t>(threads, 1)}
+    , work_stealing_{work_stealing}
+    , mutex_()
+    , queues_(work_stealing ? threads_ : 1)
+    , pending_bytes_(queues_.size(), 0)
+    , skipped_()
+{
+    std::vector<size_t> order;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        struct stat sb;
+        try
+        {
+            SOCO::FSUtils::stat(files[i], &sb);
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "[W] " << e.what() << ", not converted" << std::endl;
+            skipped_.push_back(i);
+            continue;
+        }
+        sizes_[i] = static_cast<uint64_t>(sb.st_size);
+        total_bytes_ += sizes_[i];
+        order.push_back(i);
+    }
+
+    if (policy == SchedulePolicy::LPT)
+    {
+        // stable: files of equal size keep their command line order
+        std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return sizes_[a] > sizes_[b]; });
+    }
+
+    // Greedy list scheduling: each file goes to the worker that becomes idle first
+    // This is what happens with the shared queue, and the initial assignment for work stealing
+    std::vector<uint64_t> load(threads_, 0);
+    for (const size_t file : order)
+    {
+        const size_t worker = std::min_element(load.begin(), load.end()) - load.begin();
+        load[worker] += sizes_[file];
+        const size_t queue = work_stealing_ ? worker : 0;
+        queues_[queue].push_back(file);
+        pending_bytes_[queue] += sizes_[file];
+    }
+    expected_makespan_ = *std::max_element(load.begin(), load.end());
+}
+
+bool Scheduler::next(const size_t worker, size_t& file)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t queue = work_stealing_ ? worker % queues_.size() : 0;
+    if (queues_[queue].empty())
+    {
+        if (!work_stealing_)
+        {
+            return false;
+        }
+        // victim: the worker with the most pending bytes
+        bool found = false;
+        for (size_t q = 0; q < queues_.size(); ++q)
+        {
+            if (!queues_[q].empty() && (!found || pending_bytes_[q] > pending_bytes_[queue]))
+            {
+                queue = q;
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            return false;
+        }
+        // steal from the back, with LPT the smallest file of the victim
+        file = queues_[queue].back();
+        queues_[queue].pop_back();
+    }
+    else
+    {
+        file = queues_[queue].front();
+        queues_[queue].pop_front();
+    }
+    pending_bytes_[queue] -= sizes_[file];
+    return true;
+}
@@ -0,0 +1,84 @@
+#ifndef SOCO2ROOT_SCHEDULER_H
+#define SOCO2ROOT_SCHEDULER_H
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Order in which input files are dispatched to the threads
+// FIFO: command line order
+// LPT:  largest file first, which keeps big files from starting last
+enum class SchedulePolicy
+{
+    FIFO,
+    LPT
+};
+
+SchedulePolicy parseSchedulePolicy(const std::string& name);
+
+// Distributes input files over worker threads, using the file size as cost estimate
+// Without work stealing, all workers take the next file from one shared queue. With work stealing,
+// the files are assigned to per-worker queues up front; a worker that runs out of files takes the
+// last pending file of the worker with the most pending bytes.
+// Files that can't be stat-ed are reported and skipped, the others are scheduled as usual.
+class Scheduler
+{
+    public:
+    Scheduler(const std::vector<std::string>& files, size_t threads, SchedulePolicy policy, bool work_stealing);
+
+    // NonCopyable
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // Index of the next file for worker, false if there is nothing left to do
+    // Thread safe
+    bool next(size_t worker, size_t& file);
+
+    size_t threads() const { return threads_; }
+
+    uint64_t fileSize(const size_t file) const { return sizes_[file]; }
+
+    // Indices of the files that are not scheduled because they can't be stat-ed
+    const std::vector<size_t>& skipped() const { return skipped_; }
+
+    uint64_t totalBytes() const { return total_bytes_; }
+
+    // Bytes converted by the busiest worker, if all files are converted at the same speed
+    uint64_t expectedMakespan() const { return expected_makespan_; }
+
+    private:
+    std::vector<uint64_t> sizes_;
+    uint64_t total_bytes_;
+    uint64_t expected_makespan_;
+    size_t threads_;
+    bool work_stealing_;
+
+    std::mutex mutex_;
+    std::vector<std::deque<size_t>> queues_;
+    std::vector<uint64_t> pending_bytes_;
+    std::vector<size_t> skipped_;
+};
+
+#endif // SOCO2ROOT_SCHEDULER_H
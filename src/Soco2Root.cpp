@@ -1,53 +1,1324 @@
 #include "Soco2Root.h"
 
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "TFile.h"
+#include "TFileMerger.h"
+#include "TList.h"
+#include "TMemFile.h"
+#include "TNamed.h"
+#include "TROOT.h"
 #include "TTree.h"
 
+#include "Calibration.h"
 #include "Event.h"
+#include "EventBuilder.h"
+#include "EventMerger.h"
 #include "EventReader.h"
+#include "IdDictionary.h"
+#include "RelativeTimestamps.h"
+#include "SPSCQueue.h"
+#include "ThreadSaveCout.h"
+
+using SOCO::threadsavecout;
+
+namespace
+{
+
+constexpr size_t MAX_MULTIPLICITY = std::numeric_limits<uint8_t>::max();
+
+// Dictionaries up to this size store hit_idx as UChar_t instead of UShort_t
+// All converted ids are part of the dictionary, so its largest index is 255.
+constexpr size_t SMALL_INDEX_IDS = 256;
+
+// Number of events decoded at once, see SOCO::EventReader::readBatch
+constexpr size_t BATCH_SIZE = 4096;
+
+// Number of events read ahead per input file for time-ordered merging
+constexpr size_t READ_AHEAD = 1024;
+
+// Branch buffers for OutputLayout::Flat and OutputLayout::Relative
+// Plain arrays, no TObject overhead, split into one branch per field
+struct FlatEvent
+{
+    UShort_t trigger_id;
+    ULong64_t timestamp;
+    UInt_t mult;
+    UShort_t hit_id[MAX_MULTIPLICITY];
+    UShort_t hit_adc[MAX_MULTIPLICITY];
+    ULong64_t hit_ts[MAX_MULTIPLICITY];
+    Int_t hit_dt[MAX_MULTIPLICITY];
+    UInt_t n_escaped;
+    ULong64_t hit_ts_escaped[MAX_MULTIPLICITY];
+    Float_t hit_energy[MAX_MULTIPLICITY];
+    UShort_t hit_idx[MAX_MULTIPLICITY];
+    UChar_t hit_idx_small[MAX_MULTIPLICITY];
+
+    void branch(TTree& ttree,
+                const bool relative,
+                const bool calibrated,
+                const bool indexed,
+                const bool small_index)
+    {
+        ttree.Branch("trigger_id", &trigger_id, "trigger_id/s");
+        ttree.Branch("timestamp", &timestamp, "timestamp/l");
+        ttree.Branch("mult", &mult, "mult/i");
+        ttree.Branch("hit_id", hit_id, "hit_id[mult]/s");
+        ttree.Branch("hit_adc", hit_adc, "hit_adc[mult]/s");
+        if (relative)
+        {
+            ttree.Branch("hit_dt", hit_dt, "hit_dt[mult]/I");
+            ttree.Branch("n_escaped", &n_escaped, "n_escaped/i");
+            ttree.Branch("hit_ts_escaped", hit_ts_escaped, "hit_ts_escaped[n_escaped]/l");
+        }
+        else
+        {
+            ttree.Branch("hit_ts", hit_ts, "hit_ts[mult]/l");
+        }
+        if (calibrated)
+        {
+            ttree.Branch("hit_energy", hit_energy, "hit_energy[mult]/F");
+        }
+        if (indexed && small_index)
+        {
+            ttree.Branch("hit_idx", hit_idx_small, "hit_idx[mult]/b");
+        }
+        else if (indexed)
+        {
+            ttree.Branch("hit_idx", hit_idx, "hit_idx[mult]/s");
+        }
+    }
+
+    void assign(const SOCO::EventBatch& batch, const size_t i, const bool relative)
+    {
+        const size_t first = batch.offsets[i];
+        trigger_id         = batch.trigger_ids[i];
+        timestamp          = batch.event_timestamps[i];
+        mult               = static_cast<UInt_t>(batch.multiplicity(i));
+        std::memcpy(hit_id, batch.ids.data() + first, mult * sizeof(UShort_t));
+        std::memcpy(hit_adc, batch.adcs.data() + first, mult * sizeof(UShort_t));
+        if (relative)
+        {
+            n_escaped = static_cast<UInt_t>(SOCO::encodeTimestamps(
+                timestamp, batch.timestamps.data() + first, mult, hit_dt, hit_ts_escaped));
+        }
+        else
+        {
+            std::memcpy(hit_ts, batch.timestamps.data() + first, mult * sizeof(ULong64_t));
+        }
+        if (!batch.energies.empty())
+        {
+            std::memcpy(hit_energy, batch.energies.data() + first, mult * sizeof(Float_t));
+        }
+    }
+};
+
+// Same result as SOCO::EventReader::getNextEvent
+void assign(SOCO::Event& event, const SOCO::EventBatch& batch, const size_t i)
+{
+    event.clear();
+    event.trigger_id = batch.trigger_ids[i];
+    event.timestamp  = batch.event_timestamps[i];
+    event.hits.reserve(batch.multiplicity(i));
+    for (size_t h = batch.offsets[i]; h < batch.offsets[i + 1]; ++h)
+    {
+        event.hits.emplace_back(batch.ids[h], batch.adcs[h], batch.timestamps[h]);
+    }
+}
+
+// Only used for statistics, 0 if the file can't be stat-ed
+uint64_t fileSize(const std::string& filename)
+{
+    struct stat sb;
+    if (::stat(filename.c_str(), &sb) == -1)
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(sb.st_size);
+}
+
+// ROOT's internal locks and a thread local gDirectory allow creating, filling, compressing and
+// writing independent files in parallel without any lock held by soco2root
+void enableThreadSafety()
+{
+    static std::once_flag once;
+    std::call_once(once, []() { ROOT::EnableThreadSafety(); });
+}
+
+// Set by Soco2Root::stopFollowing, e.g. from a signal handler
+std::atomic<bool> stop_following{false};
+
+// Waits for changes of a file with inotify, falls back to sleeping where inotify is not available
+// Changes on network file systems are not reported by inotify, so wait always returns after the
+// timeout and the caller has to check the file size.
+class FileWatcher
+{
+    public:
+    explicit FileWatcher(const std::string& filename)
+        : fd_{inotify_init1(IN_NONBLOCK | IN_CLOEXEC)}
+    {
+        if (fd_ != -1 && inotify_add_watch(fd_, filename.c_str(), IN_MODIFY | IN_CLOSE_WRITE) == -1)
+        {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    ~FileWatcher()
+    {
+        if (fd_ != -1)
+        {
+            close(fd_);
+        }
+    }
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Returns true if a change was reported before the timeout
+    bool wait(const int timeout_ms)
+    {
+        if (fd_ == -1)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+            return false;
+        }
+
+        struct pollfd pfd = {fd_, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) <= 0)
+        {
+            return false;
+        }
+        // drain all pending events
+        char buffer[4096];
+        while (read(fd_, buffer, sizeof(buffer)) > 0)
+            ;
+        return true;
+    }
+
+    private:
+    int fd_;
+};
+
+// Number of batches decoded ahead in pipelined mode
+constexpr size_t PIPELINE_DEPTH = 4;
+
+// Calls next(batch) on a decoder thread, up to PIPELINE_DEPTH batches ahead of the caller
+// Same interface as next. Batches are preallocated and recycled: a free queue carries empty
+// batches to the decoder, a filled queue carries decoded batches back. Both are lock-free SPSC
+// queues. A batch with 0 events ends the stream.
+template <class NextBatch>
+class PipelinedBatches
+{
+    public:
+    explicit PipelinedBatches(NextBatch next)
+        : next_(next)
+        , slots_(PIPELINE_DEPTH)
+        , free_(PIPELINE_DEPTH)
+        , filled_(PIPELINE_DEPTH)
+        , stop_{false}
+        , done_{false}
+        , error_()
+        , decoder_()
+    {
+        for (auto& slot : slots_)
+        {
+            free_.push(&slot);
+        }
+        decoder_ = std::thread(&PipelinedBatches::decode, this);
+    }
+
+    ~PipelinedBatches()
+    {
+        stop_ = true;
+        if (decoder_.joinable())
+        {
+            decoder_.join();
+        }
+    }
+
+    PipelinedBatches(const PipelinedBatches&) = delete;
+    PipelinedBatches& operator=(const PipelinedBatches&) = delete;
+
+    size_t operator()(SOCO::EventBatch& batch)
+    {
+        if (done_)
+        {
+            return 0;
+        }
+
+        Slot* slot = nullptr;
+        SOCO::Backoff backoff;
+        while (!filled_.pop(slot))
+        {
+            backoff();
+        }
+        // hand the buffers of the previous batch to the decoder for reuse
+        std::swap(batch, slot->batch);
+        const size_t events = slot->events;
+        free_.push(slot);
+
+        if (events == 0)
+        {
+            done_ = true;
+            decoder_.join();
+            if (error_)
+            {
+                std::rethrow_exception(error_);
+            }
+        }
+        return events;
+    }
+
+    private:
+    struct Slot
+    {
+        SOCO::EventBatch batch;
+        size_t events = 0;
+    };
+
+    void decode()
+    {
+        SOCO::Backoff backoff;
+        for (;;)
+        {
+            Slot* slot = nullptr;
+            while (!free_.pop(slot))
+            {
+                if (stop_)
+                {
+                    return;
+                }
+                backoff();
+            }
+            backoff.reset();
+
+            try
+            {
+                slot->events = next_(slot->batch);
+            }
+            catch (...)
+            {
+                error_       = std::current_exception();
+                slot->events = 0;
+            }
+            // never full, there are only PIPELINE_DEPTH slots
+            filled_.push(slot);
+            if (slot->events == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    NextBatch next_;
+    std::vector<Slot> slots_;
+    SOCO::SPSCQueue<Slot*> free_;
+    SOCO::SPSCQueue<Slot*> filled_;
+    std::atomic<bool> stop_;
+    bool done_;
+    std::exception_ptr error_;
+    std::thread decoder_;
+};
+
+// Sets the TNamed "ids" in the UserInfo of ttree, see SOCO::IdDictionary::toString
+void setIds(TTree& ttree, const std::string& ids)
+{
+    TNamed* stored = static_cast<TNamed*>(ttree.GetUserInfo()->FindObject("ids"));
+    if (stored)
+    {
+        stored->SetTitle(ids.c_str());
+    }
+    else
+    {
+        ttree.GetUserInfo()->Add(new TNamed("ids", ids.c_str()));
+    }
+}
+
+// Tree in the configured layout
+class EventTree
+{
+    public:
+    EventTree(const std::string& name, TDirectory* directory, const Soco2RootOptions& options)
+        : ttree_(name.c_str(), "SOCO Events")
+        , flat_layout_(options.layout != OutputLayout::Event)
+        , relative_(options.layout == OutputLayout::Relative)
+        , calibrated_(options.calibration != nullptr)
+        , indexed_(options.id_index)
+        , dictionary_(options.id_dictionary.get())
+        , small_index_(dictionary_ && dictionary_->size() <= SMALL_INDEX_IDS)
+        , seen_()
+        , event_()
+        , energy_()
+        , index_()
+        , small_index_values_()
+        , flat_()
+    {
+        if (indexed_ && !dictionary_)
+        {
+            throw std::runtime_error("Soco2Root::process - the id index needs an id dictionary");
+        }
+        ttree_.SetDirectory(directory);
+        if (flat_layout_)
+        {
+            flat_.branch(ttree_, relative_, calibrated_, indexed_, small_index_);
+        }
+        else
+        {
+            ttree_.Branch("events", &event_);
+            if (calibrated_)
+            {
+                ttree_.Branch("energy", &energy_);
+            }
+            if (indexed_ && small_index_)
+            {
+                ttree_.Branch("hit_idx", &small_index_values_);
+            }
+            else if (indexed_)
+            {
+                ttree_.Branch("hit_idx", &index_);
+            }
+        }
+        ttree_.SetBasketSize("*", options.basket_size);
+        ttree_.SetAutoFlush(options.auto_flush);
+    }
+
+    EventTree(const EventTree&) = delete;
+    EventTree& operator=(const EventTree&) = delete;
 
-static std::mutex cr;
+    void fill(const SOCO::EventBatch& batch, const size_t i)
+    {
+        const size_t first = batch.offsets[i];
+        const size_t last  = batch.offsets[i + 1];
+        if (flat_layout_)
+        {
+            flat_.assign(batch, i, relative_);
+            if (indexed_ && small_index_)
+            {
+                for (size_t h = first; h < last; ++h)
+                {
+                    flat_.hit_idx_small[h - first] =
+                        static_cast<UChar_t>(dictionary_->index(batch.ids[h]));
+                }
+            }
+            else if (indexed_)
+            {
+                for (size_t h = first; h < last; ++h)
+                {
+                    flat_.hit_idx[h - first] = dictionary_->index(batch.ids[h]);
+                }
+            }
+        }
+        else
+        {
+            assign(event_, batch, i);
+            if (calibrated_)
+            {
+                energy_.assign(batch.energies.data() + first, batch.energies.data() + last);
+            }
+            if (indexed_ && small_index_)
+            {
+                small_index_values_.clear();
+                for (size_t h = first; h < last; ++h)
+                {
+                    small_index_values_.push_back(
+                        static_cast<UChar_t>(dictionary_->index(batch.ids[h])));
+                }
+            }
+            else if (indexed_)
+            {
+                index_.clear();
+                for (size_t h = first; h < last; ++h)
+                {
+                    index_.push_back(dictionary_->index(batch.ids[h]));
+                }
+            }
+        }
+        if (!dictionary_)
+        {
+            for (size_t h = first; h < last; ++h)
+            {
+                seen_[batch.ids[h]] = true;
+            }
+        }
+        ttree_.Fill();
+    }
+
+    void autoSave()
+    {
+        storeIds();
+        ttree_.AutoSave("SaveSelf");
+    }
+
+    // The ids of the dictionary, otherwise of all hits filled so far, as TNamed "ids" in the UserInfo
+    void storeIds()
+    {
+        std::string ids;
+        if (dictionary_)
+        {
+            ids = dictionary_->toString();
+        }
+        else
+        {
+            SOCO::IdDictionary seen;
+            seen.add(seen_);
+            ids = seen.toString();
+        }
+        setIds(ttree_, ids);
+    }
+
+    // Adds the ids of all hits filled so far to the ids of this tree, none with a dictionary
+    void addSeenIds(SeenIds& ids) const { ids[ttree_.GetName()] |= seen_; }
+
+    private:
+    TTree ttree_;
+    bool flat_layout_;
+    bool relative_;
+    bool calibrated_;
+    bool indexed_;
+    const SOCO::IdDictionary* dictionary_;
+    bool small_index_;
+    std::bitset<65536> seen_;
+    SOCO::Event event_;
+    std::vector<float> energy_;
+    std::vector<UShort_t> index_;
+    std::vector<UChar_t> small_index_values_;
+    FlatEvent flat_;
+};
+
+// Output file(s) with the tree(s) in the configured layout
+// Without a trigger split, all events go to the tree "ttree". Otherwise, each trigger id gets its
+// own tree "ttree_<id>" or its own file (see triggerFilename) when its first event is filled.
+class OutputTree
+{
+    public:
+    // With image set, the file is only created in memory and its contents are copied to image on close
+    OutputTree(const std::string& filename, const Soco2RootOptions& options, std::vector<char>* image)
+        : context_()
+        , filename_(filename)
+        , options_(options)
+        , image_(image)
+        , files_()
+        , trees_()
+        , tree_of_trigger_()
+    {
+        if (image && options.split_triggers == TriggerSplit::File)
+        {
+            throw std::runtime_error("Soco2Root::processToMemory - can't split the output into files");
+        }
+        if (options.split_triggers != TriggerSplit::File)
+        {
+            files_.emplace_back(image ? new TMemFile(filename.c_str(), "RECREATE")
+                                      : new TFile(filename.c_str(), "RECREATE"));
+            configure(*files_.back());
+        }
+        if (options.split_triggers == TriggerSplit::None)
+        {
+            trees_.emplace_back(new EventTree("ttree", files_.back().get(), options));
+        }
+    }
+
+    OutputTree(const OutputTree&) = delete;
+    OutputTree& operator=(const OutputTree&) = delete;
+
+    void fill(const SOCO::EventBatch& batch)
+    {
+        if (options_.split_triggers == TriggerSplit::None)
+        {
+            EventTree& tree = *trees_.front();
+            for (size_t i = 0; i < batch.events; ++i)
+            {
+                tree.fill(batch, i);
+            }
+            return;
+        }
+        for (size_t i = 0; i < batch.events; ++i)
+        {
+            treeOf(batch.trigger_ids[i]).fill(batch, i);
+        }
+    }
+
+    // Writes all entries filled so far, such that readers of the file see them
+    void autoSave()
+    {
+        for (auto& tree : trees_)
+        {
+            tree->autoSave();
+        }
+    }
+
+    // Returns the size of all written files, adds the ids of the hits of each tree to seen
+    uint64_t close(SeenIds& seen)
+    {
+        for (auto& tree : trees_)
+        {
+            tree->storeIds();
+            tree->addSeenIds(seen);
+        }
+        uint64_t bytes = 0;
+        for (auto& tfile : files_)
+        {
+            tfile->Write();
+            bytes += static_cast<uint64_t>(tfile->GetSize());
+        }
+        if (image_)
+        {
+            auto& memfile = static_cast<TMemFile&>(*files_.front());
+            image_->resize(static_cast<size_t>(memfile.GetSize()));
+            memfile.CopyTo(image_->data(), memfile.GetSize());
+        }
+        for (auto& tfile : files_)
+        {
+            tfile->Close();
+        }
+        return bytes;
+    }
+
+    private:
+    void configure(TFile& tfile) const
+    {
+        if (options_.compressionSettings() >= 0)
+        {
+            tfile.SetCompressionSettings(options_.compressionSettings());
+        }
+    }
+
+    EventTree& treeOf(const uint16_t trigger_id)
+    {
+        const auto it = tree_of_trigger_.find(trigger_id);
+        if (it != tree_of_trigger_.end())
+        {
+            return *it->second;
+        }
 
-auto threadsavecout = [](const std::string& x) {
-    static std::mutex m;
-    std::lock_guard<std::mutex> mylock(m);
-    std::cout << x << std::endl;
-    return;
+        TFile* tfile = nullptr;
+        std::string name;
+        if (options_.split_triggers == TriggerSplit::File)
+        {
+            files_.emplace_back(new TFile(triggerFilename(filename_, trigger_id).c_str(), "RECREATE"));
+            configure(*files_.back());
+            tfile = files_.back().get();
+            name  = "ttree";
+        }
+        else
+        {
+            tfile = files_.front().get();
+            name  = "ttree_" + std::to_string(trigger_id);
+        }
+        trees_.emplace_back(new EventTree(name, tfile, options_));
+        tree_of_trigger_[trigger_id] = trees_.back().get();
+        return *trees_.back();
+    }
+
+    // the last created file is the current directory of this thread while the trees exist
+    TDirectory::TContext context_;
+    std::string filename_;
+    Soco2RootOptions options_;
+    std::vector<char>* image_;
+    // trees are deleted before their files
+    std::vector<std::unique_ptr<TFile>> files_;
+    std::vector<std::unique_ptr<EventTree>> trees_;
+    std::unordered_map<uint16_t, EventTree*> tree_of_trigger_;
 };
 
-Soco2Root::Soco2Root(const std::string& in, const std::string& out)
+// Writes all events returned in batches by next(batch) into a new tree in filename
+template <class NextBatch>
+void fillTree(const std::string& filename,
+              const Soco2RootOptions& options,
+              ConversionStats& stats,
+              SeenIds& seen,
+              std::vector<char>* image,
+              NextBatch next)
+{
+    SOCO::EventBatch batch;
+    OutputTree tree(filename, options, image);
+
+    auto start = std::chrono::steady_clock::now();
+    while (next(batch))
+    {
+        stats.decode_seconds += secondsSince(start);
+        stats.events += batch.events;
+        stats.hits += batch.hits;
+
+        start = std::chrono::steady_clock::now();
+        tree.fill(batch);
+        stats.fill_seconds += secondsSince(start);
+        start = std::chrono::steady_clock::now();
+    }
+    stats.decode_seconds += secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    stats.output_bytes += tree.close(seen);
+    stats.write_seconds += secondsSince(start);
+}
+
+template <class NextBatch>
+void decodeAndFillTree(const std::string& filename,
+                       const Soco2RootOptions& options,
+                       ConversionStats& stats,
+                       SeenIds& seen,
+                       std::vector<char>* image,
+                       NextBatch next)
+{
+    if (options.pipeline)
+    {
+        PipelinedBatches<NextBatch> pipelined(next);
+        fillTree(filename, options, stats, seen, image, std::ref(pipelined));
+    }
+    else
+    {
+        fillTree(filename, options, stats, seen, image, next);
+    }
+}
+
+template <class NextBatch>
+void writeTree(const std::string& filename,
+               const Soco2RootOptions& options,
+               ConversionStats& stats,
+               SeenIds& seen,
+               std::vector<char>* image,
+               NextBatch next)
+{
+    if (options.calibration)
+    {
+        // part of decoding, so it runs on the decoder thread with the pipeline
+        const SOCO::Calibration& calibration = *options.calibration;
+        decodeAndFillTree(filename, options, stats, seen, image, [&calibration, next](SOCO::EventBatch& batch) mutable {
+            const size_t events = next(batch);
+            calibration.apply(batch);
+            return events;
+        });
+    }
+    else
+    {
+        decodeAndFillTree(filename, options, stats, seen, image, next);
+    }
+}
+
+// Adds the ids of all hits in the file that are kept by the filter of the reader
+void addIds(const SOCO::EventReader& eventReader, SOCO::IdDictionary& dictionary)
+{
+    const SOCO::EventFilter* filter = eventReader.filter();
+    std::bitset<65536> seen;
+    for (const SOCO::EventView event : eventReader.events())
+    {
+        // only the events and hits that are converted, as selected by readBatch
+        if (filter && !filter->accept(event))
+        {
+            continue;
+        }
+        for (const SOCO::HitView hit : event)
+        {
+            if (!filter || filter->keep(hit))
+            {
+                seen[hit.id()] = true;
+            }
+        }
+    }
+    dictionary.add(seen);
+}
+
+} // namespace {anonymous}
+
+TriggerSplit parseTriggerSplit(const std::string& name)
+{
+    if (name == "none")
+    {
+        return TriggerSplit::None;
+    }
+    if (name == "tree")
+    {
+        return TriggerSplit::Tree;
+    }
+    if (name == "file")
+    {
+        return TriggerSplit::File;
+    }
+    throw std::runtime_error("Unknown trigger split '" + name + "', use 'none', 'tree' or 'file'");
+}
+
+std::string triggerFilename(const std::string& filename, const uint16_t trigger_id)
+{
+    const std::string infix = ".trg" + std::to_string(trigger_id);
+    const size_t slash      = filename.rfind('/');
+    const size_t dot        = filename.rfind('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    {
+        return filename + infix;
+    }
+    return filename.substr(0, dot) + infix + filename.substr(dot);
+}
+
+OutputLayout parseOutputLayout(const std::string& name)
+{
+    if (name == "event")
+    {
+        return OutputLayout::Event;
+    }
+    if (name == "flat")
+    {
+        return OutputLayout::Flat;
+    }
+    if (name == "relative")
+    {
+        return OutputLayout::Relative;
+    }
+    throw std::runtime_error("Unknown output layout '" + name + "', use 'event', 'flat' or 'relative'");
+}
+
+CompressionAlgorithm parseCompressionAlgorithm(const std::string& name)
+{
+    if (name == "zlib")
+    {
+        return CompressionAlgorithm::ZLIB;
+    }
+    if (name == "lzma")
+    {
+        return CompressionAlgorithm::LZMA;
+    }
+    if (name == "lz4")
+    {
+        return CompressionAlgorithm::LZ4;
+    }
+    if (name == "zstd")
+    {
+        return CompressionAlgorithm::ZSTD;
+    }
+    throw std::runtime_error("Unknown compression algorithm '" + name + "', use 'zlib', 'lzma', 'lz4' or 'zstd'");
+}
+
+void applyProfile(Soco2RootOptions& options, const std::string& profile)
+{
+    if (profile == "fast")
+    {
+        options.compression       = CompressionAlgorithm::LZ4;
+        options.compression_level = 1;
+        options.basket_size       = 256 * 1024;
+        options.auto_flush        = -64000000;
+    }
+    else if (profile == "balanced")
+    {
+        options.compression       = CompressionAlgorithm::ZSTD;
+        options.compression_level = 5;
+        options.basket_size       = 64 * 1024;
+        options.auto_flush        = -30000000;
+    }
+    else if (profile == "archive")
+    {
+        options.compression       = CompressionAlgorithm::LZMA;
+        options.compression_level = 8;
+        options.basket_size       = 512 * 1024;
+        options.auto_flush        = -100000000;
+    }
+    else
+    {
+        throw std::runtime_error("Unknown profile '" + profile + "', use 'fast', 'balanced' or 'archive'");
+    }
+}
+
+int Soco2RootOptions::compressionSettings() const
+{
+    if (compression == CompressionAlgorithm::Default && compression_level < 0)
+    {
+        return -1;
+    }
+
+    int level = compression_level;
+    if (level < 0)
+    {
+        // levels of ROOT's recommended settings for each algorithm
+        switch (compression)
+        {
+        case CompressionAlgorithm::LZMA: level = 7; break;
+        case CompressionAlgorithm::LZ4: level = 4; break;
+        case CompressionAlgorithm::ZSTD: level = 5; break;
+        default: level = 1; break;
+        }
+    }
+    return 100 * static_cast<int>(compression) + std::min(level, 9);
+}
+
+Soco2Root::Soco2Root(const std::string& in, const std::string& out, const Soco2RootOptions& opts)
     : input(in)
+    , time_ordered_inputs()
     , output(out)
+    , options(opts)
+    , stats()
+    , image(nullptr)
 {
+    enableThreadSafety();
     threadsavecout(input + " -> " + output);
+    stats.input  = input;
+    stats.output = output;
+}
+
+Soco2Root::Soco2Root(const std::vector<std::string>& ins, const std::string& out, const Soco2RootOptions& opts)
+    : input()
+    , time_ordered_inputs(ins)
+    , output(out)
+    , options(opts)
+    , stats()
+    , image(nullptr)
+{
+    enableThreadSafety();
+    for (const std::string& in : ins)
+    {
+        input += (input.empty() ? "" : " + ") + in;
+    }
+    threadsavecout(input + " -> " + output + " (time-ordered)");
+    stats.input  = input;
+    stats.output = output;
 }
 
 void Soco2Root::process()
 {
-    SOCO::Event event;
+    const auto start = std::chrono::steady_clock::now();
 
-    SOCO::EventReader eventReader;
-    eventReader.mapFile(input);
+    if (!time_ordered_inputs.empty())
+    {
+        processTimeOrdered();
+    }
+    else if (options.follow)
+    {
+        follow();
+    }
+    else
+    {
+        SOCO::EventReader eventReader;
+        eventReader.mapFile(input, options.use_mmap, options.stream_memory);
+        eventReader.setFilter(options.filter);
+        stats.map_seconds = secondsSince(start);
 
-    // ROOT is not thread friendly
-    // These operations access an implicit global state and have to be locked
-    cr.lock();
-    TFile tfile(output.c_str(), "RECREATE");
-    TTree ttree("ttree", "SOCO Events");
-    ttree.SetDirectory(&tfile);
-    ttree.Branch("events", &event);
-    cr.unlock();
+        convert(eventReader);
+        stats.io_wait_seconds = eventReader.ioWaitSeconds();
+    }
+
+    stats.input_bytes = time_ordered_inputs.empty() ? fileSize(input) : 0;
+    for (const std::string& in : time_ordered_inputs)
+    {
+        stats.input_bytes += fileSize(in);
+    }
+    if (image)
+    {
+        stats.output_bytes = image->size();
+    }
+    else if (options.split_triggers != TriggerSplit::File)
+    {
+        stats.output_bytes = fileSize(output);
+    }
+    stats.total_seconds   = secondsSince(start);
+    stats.peak_rss_kb     = peakRSSKilobytes();
+    threadsavecout(stats.summary());
+}
 
-    while (eventReader.getNextEvent(event))
+std::vector<char> Soco2Root::processToMemory()
+{
+    std::vector<char> result;
+    image = &result;
+    try
     {
-        ttree.Fill();
+        process();
     }
+    catch (...)
+    {
+        image = nullptr;
+        throw;
+    }
+    image = nullptr;
+    return result;
+}
 
-    cr.lock();
-    tfile.Write();
+std::shared_ptr<const SOCO::IdDictionary> Soco2Root::scanIds(const std::vector<std::string>& files,
+                                                              const Soco2RootOptions& options)
+{
+    if (options.stream_memory)
+    {
+        throw std::runtime_error("Soco2Root::scanIds - not available for streamed files");
+    }
+    std::shared_ptr<SOCO::IdDictionary> dictionary(new SOCO::IdDictionary());
+    for (const std::string& file : files)
+    {
+        SOCO::EventReader eventReader;
+        eventReader.mapFile(file, options.use_mmap);
+        eventReader.setFilter(options.filter);
+        addIds(eventReader, *dictionary);
+    }
+    return dictionary;
+}
+
+void Soco2Root::storeIds(const std::string& filename, const SeenIds& ids)
+{
+    TDirectory::TContext context;
+    TFile tfile(filename.c_str(), "UPDATE");
+    if (tfile.IsZombie())
+    {
+        throw std::runtime_error("Soco2Root::storeIds - can't open " + filename);
+    }
+    for (const auto& tree_ids : ids)
+    {
+        TTree* ttree = nullptr;
+        tfile.GetObject(tree_ids.first.c_str(), ttree);
+        if (!ttree)
+        {
+            continue;
+        }
+        SOCO::IdDictionary dictionary;
+        dictionary.add(tree_ids.second);
+        setIds(*ttree, dictionary.toString());
+        // only the tree header with the UserInfo is written again, not its baskets
+        ttree->Write("", TObject::kOverwrite);
+    }
     tfile.Close();
-    cr.unlock();
+}
+
+void Soco2Root::convert(SOCO::EventReader& eventReader)
+{
+    // the index of each hit needs the ids of the whole file first, the same in all chunks
+    if (options.id_index && !options.id_dictionary)
+    {
+        if (eventReader.isStreamed())
+        {
+            throw std::runtime_error("Soco2Root::process - the id index is not available for streamed files");
+        }
+        std::shared_ptr<SOCO::IdDictionary> dictionary(new SOCO::IdDictionary());
+        addIds(eventReader, *dictionary);
+        options.id_dictionary = dictionary;
+    }
+
+    const bool ranged = (options.first_event > 0 || options.max_events != std::numeric_limits<uint64_t>::max());
+    if (options.rebuild)
+    {
+        if (options.chunks > 1 || ranged)
+        {
+            throw std::runtime_error("Soco2Root::process - rebuilding events can't be combined with chunks or "
+                                     "event ranges");
+        }
+        rebuildEvents([&eventReader](SOCO::EventBatch& batch, size_t max_events) {
+            return eventReader.readBatch(batch, max_events);
+        });
+        return;
+    }
+    // chunks need random access to the whole file
+    if (options.chunks > 1 && eventReader.isStreamed())
+    {
+        threadsavecout("[W] " + input + ": streamed, converting in a single chunk instead of " +
+                       std::to_string(options.chunks));
+    }
+    if (options.chunks > 1 && !eventReader.isStreamed())
+    {
+        if (image)
+        {
+            throw std::runtime_error("Soco2Root::processToMemory - chunks are not supported");
+        }
+        if (ranged)
+        {
+            throw std::runtime_error("Soco2Root::process - event ranges can't be combined with chunks");
+        }
+        if (options.split_triggers == TriggerSplit::File)
+        {
+            throw std::runtime_error("Soco2Root::process - chunks can't be split into files per trigger");
+        }
+        processChunks(eventReader);
+        return;
+    }
+
+    bool in_range      = (options.first_event == 0 || eventReader.seek(options.first_event));
+    uint64_t remaining = options.max_events;
+    writeTree(output, options, stats, seen_ids, image, [&](SOCO::EventBatch& batch) -> size_t {
+        if (!in_range || remaining == 0)
+        {
+            return 0;
+        }
+        const size_t n = eventReader.readBatch(batch, std::min<uint64_t>(BATCH_SIZE, remaining));
+        remaining -= n;
+        return n;
+    });
+}
+
+void Soco2Root::stopFollowing()
+{
+    stop_following = true;
+}
+
+void Soco2Root::follow()
+{
+    if (image || options.chunks > 1 || options.stream_memory || options.first_event > 0 ||
+        options.max_events != std::numeric_limits<uint64_t>::max())
+    {
+        throw std::runtime_error("Soco2Root::follow - can't be combined with chunks, streaming, event ranges "
+                                 "or a merged output");
+    }
+    if (options.id_index && !options.id_dictionary)
+    {
+        throw std::runtime_error("Soco2Root::follow - the id index needs a given id dictionary");
+    }
+    if (options.rebuild)
+    {
+        throw std::runtime_error("Soco2Root::follow - can't rebuild events");
+    }
+
+    FileWatcher watcher(input);
+    auto last_growth = std::chrono::steady_clock::now();
+    auto idle        = [&]() {
+        return stop_following ||
+               (options.idle_timeout > 0 && secondsSince(last_growth) >= options.idle_timeout);
+    };
+
+    // soco2 may not have written the header and metadata yet
+    std::unique_ptr<SOCO::EventReader> eventReader;
+    for (;;)
+    {
+        try
+        {
+            eventReader.reset(new SOCO::EventReader());
+            eventReader->mapFile(input, options.use_mmap);
+            eventReader->setFilter(options.filter);
+            break;
+        }
+        catch (const std::exception&)
+        {
+            if (idle())
+            {
+                throw;
+            }
+        }
+        if (watcher.wait(options.poll_interval_ms))
+        {
+            last_growth = std::chrono::steady_clock::now();
+        }
+    }
+
+    SOCO::EventBatch batch;
+    OutputTree tree(output, options, nullptr);
+    auto last_save = std::chrono::steady_clock::now();
+    bool unsaved   = false;
+    for (;;)
+    {
+        auto start     = std::chrono::steady_clock::now();
+        const size_t n = eventReader->readBatch(batch, BATCH_SIZE);
+        if (options.calibration)
+        {
+            options.calibration->apply(batch);
+        }
+        stats.decode_seconds += secondsSince(start);
+        if (n)
+        {
+            stats.events += batch.events;
+            stats.hits += batch.hits;
+            start = std::chrono::steady_clock::now();
+            tree.fill(batch);
+            stats.fill_seconds += secondsSince(start);
+            unsaved = true;
+        }
+
+        if (unsaved && secondsSince(last_save) >= options.autosave_seconds)
+        {
+            start = std::chrono::steady_clock::now();
+            tree.autoSave();
+            stats.write_seconds += secondsSince(start);
+            last_save = std::chrono::steady_clock::now();
+            unsaved   = false;
+        }
+
+        if (n == 0)
+        {
+            // all complete events are converted, wait for more
+            if (idle())
+            {
+                break;
+            }
+            watcher.wait(options.poll_interval_ms);
+            if (eventReader->refresh() > 0)
+            {
+                last_growth = std::chrono::steady_clock::now();
+            }
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    stats.output_bytes += tree.close(seen_ids);
+    stats.write_seconds += secondsSince(start);
+}
+
+void Soco2Root::processTimeOrdered()
+{
+    if (options.chunks > 1 || options.follow || options.first_event > 0 ||
+        options.max_events != std::numeric_limits<uint64_t>::max())
+    {
+        throw std::runtime_error("Soco2Root::processTimeOrdered - can't be combined with chunks, follow mode or "
+                                 "event ranges");
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    if (options.id_index && !options.id_dictionary)
+    {
+        options.id_dictionary = scanIds(time_ordered_inputs, options);
+    }
+    SOCO::EventMerger merger(
+        time_ordered_inputs, READ_AHEAD, options.use_mmap, options.stream_memory, options.filter);
+    stats.map_seconds = secondsSince(start);
+
+    if (options.rebuild)
+    {
+        rebuildEvents([&merger](SOCO::EventBatch& batch, size_t max_events) {
+            return merger.readBatch(batch, max_events);
+        });
+    }
+    else
+    {
+        writeTree(output, options, stats, seen_ids, image, [&merger](SOCO::EventBatch& batch) {
+            return merger.readBatch(batch, BATCH_SIZE);
+        });
+    }
+
+    if (merger.unorderedEvents())
+    {
+        threadsavecout("[W] " + std::to_string(merger.unorderedEvents()) +
+                       " events were not sorted by time in their input file, the output is not completely "
+                       "time-ordered");
+    }
+}
+
+void Soco2Root::rebuildEvents(const std::function<size_t(SOCO::EventBatch&, size_t)>& next)
+{
+    SOCO::EventBuilder builder(next, options.rebuild_window, options.reorder_window, BATCH_SIZE);
+    writeTree(output, options, stats, seen_ids, image, [&builder](SOCO::EventBatch& batch) {
+        return builder.readBatch(batch, BATCH_SIZE);
+    });
+
+    if (builder.unorderedHits())
+    {
+        threadsavecout("[W] " + std::to_string(builder.unorderedHits()) +
+                       " hits were read after later hits were already assigned to events, increase the "
+                       "reorder window");
+    }
+}
+
+void Soco2Root::processChunks(const SOCO::EventReader& eventReader)
+{
+    const auto chunks = eventReader.splitIntoChunks(options.chunks);
+    if (chunks.size() < 2)
+    {
+        size_t pos       = chunks.empty() ? 0 : chunks.front().begin;
+        const size_t end = chunks.empty() ? 0 : chunks.front().end;
+        writeTree(output, options, stats, seen_ids, image, [&](SOCO::EventBatch& batch) {
+            return eventReader.readBatchAt(batch, BATCH_SIZE, pos, end);
+        });
+        return;
+    }
+
+    // Each chunk is converted into its own temporary file, which are concatenated in order
+    std::vector<std::string> parts;
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        parts.push_back(output + ".chunk" + std::to_string(i));
+    }
+
+    std::vector<std::thread> workers;
+    std::vector<ConversionStats> chunk_stats(chunks.size());
+    std::vector<SeenIds> chunk_ids(chunks.size());
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        workers.emplace_back([&, i]() {
+            try
+            {
+                size_t pos = chunks[i].begin;
+                writeTree(parts[i],
+                          options,
+                          chunk_stats[i],
+                          chunk_ids[i],
+                          nullptr,
+                          [&](SOCO::EventBatch& batch) {
+                              return eventReader.readBatchAt(batch, BATCH_SIZE, pos, chunks[i].end);
+                          });
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                error = std::current_exception();
+            }
+        });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    for (const auto& s : chunk_stats)
+    {
+        stats += s;
+    }
+
+    bool merged = false;
+    if (!error)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        TFileMerger merger(false, false);
+        merger.SetFastMethod(true);
+        if (options.compressionSettings() >= 0)
+        {
+            merged = merger.OutputFile(output.c_str(), "RECREATE", options.compressionSettings());
+        }
+        else
+        {
+            merged = merger.OutputFile(output.c_str(), "RECREATE");
+        }
+        for (const auto& part : parts)
+        {
+            merged = merged && merger.AddFile(part.c_str(), false);
+        }
+        merged = merged && merger.Merge();
+        stats.write_seconds += secondsSince(start);
+    }
+
+    for (const auto& part : parts)
+    {
+        std::remove(part.c_str());
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    if (!merged)
+    {
+        throw std::runtime_error("Soco2Root::processChunks - failed to merge chunks into " + output);
+    }
+
+    // without a dictionary, the merged trees only have the ids of the chunk they were created from
+    for (const auto& ids : chunk_ids)
+    {
+        for (const auto& tree_ids : ids)
+        {
+            seen_ids[tree_ids.first] |= tree_ids.second;
+        }
+    }
+    if (!options.id_dictionary)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        storeIds(output, seen_ids);
+        stats.write_seconds += secondsSince(start);
+    }
 }
@@ -20,12 +20,139 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
+
+#include "ConversionStats.h"
+
+namespace SOCO
+{
+class Calibration;
+class EventFilter;
+class IdDictionary;
+class EventReader;
+struct EventBatch;
+}
+
+// Ids of all converted hits of each output tree, by tree name
+using SeenIds = std::map<std::string, std::bitset<65536>>;
+
+// Layout of the output tree
+// Event: single branch "events" of type SOCO::Event (default)
+// Flat:  split branches trigger_id, timestamp, mult, hit_id[mult], hit_adc[mult], hit_ts[mult]
+// Relative: like Flat, with the hit timestamps relative to the event timestamp, hit_dt[mult]
+//           (int32), n_escaped and hit_ts_escaped[n_escaped], see SOCO::decodeTimestamps
+// With a calibration, there is an additional branch with the energy of each hit:
+// "energy" of type std::vector<float> (Event) or hit_energy[mult] (Flat)
+enum class OutputLayout
+{
+    Event,
+    Flat,
+    Relative
+};
+
+OutputLayout parseOutputLayout(const std::string& name);
+
+// Separate outputs for each trigger id, in order of the events
+// Tree: trees "ttree_<id>" in the output file
+// File: tree "ttree" in one file per trigger id, see triggerFilename
+enum class TriggerSplit
+{
+    None,
+    Tree,
+    File
+};
+
+TriggerSplit parseTriggerSplit(const std::string& name);
+
+// Output filename for a trigger id with TriggerSplit::File, e.g. run.root -> run.trg3.root
+std::string triggerFilename(const std::string& filename, uint16_t trigger_id);
+
+// ROOT compression algorithms, same values as ROOT::RCompressionSetting::EAlgorithm
+enum class CompressionAlgorithm
+{
+    Default = 0,
+    ZLIB    = 1,
+    LZMA    = 2,
+    LZ4     = 4,
+    ZSTD    = 5
+};
+
+CompressionAlgorithm parseCompressionAlgorithm(const std::string& name);
+
+struct Soco2RootOptions;
+
+// Presets for compression, basket size and auto-flush:
+// fast:     LZ4 level 1, 256 KiB baskets, flush every 64 MB
+// balanced: ZSTD level 5, 64 KiB baskets, flush every 30 MB
+// archive:  LZMA level 8, 512 KiB baskets, flush every 100 MB
+void applyProfile(Soco2RootOptions& options, const std::string& profile);
+
+struct Soco2RootOptions
+{
+    OutputLayout layout         = OutputLayout::Event;
+    TriggerSplit split_triggers = TriggerSplit::None;
+    // Number of event-aligned chunks of a single file converted in parallel
+    int chunks = 1;
+    // Range of events to convert, uses the sparse event index to seek
+    uint64_t first_event = 0;
+    uint64_t max_events  = std::numeric_limits<uint64_t>::max();
+    // Without mmap (always on remote file systems), files are streamed through a ring buffer of
+    // this many bytes if set, otherwise they are read to memory completely
+    bool use_mmap        = true;
+    size_t stream_memory = 0;
+    // ROOT defaults unless set, level < 0 uses the usual level of the algorithm
+    CompressionAlgorithm compression = CompressionAlgorithm::Default;
+    int compression_level            = -1;
+    int basket_size                  = 32000;
+    // > 0: number of entries, < 0: number of bytes, like TTree::SetAutoFlush
+    int64_t auto_flush = -30000000;
+    // Decode on a second thread while the tree is filled and compressed
+    bool pipeline = false;
+    // Follow files that are still being written: wait for new events until no new data arrived for
+    // idle_timeout seconds (0: until stopFollowing is called), save the tree every autosave_seconds
+    bool follow             = false;
+    int poll_interval_ms    = 1000;
+    double idle_timeout     = 0;
+    double autosave_seconds = 10;
+    // Events and hits to convert, see SOCO::EventFilter, everything if not set
+    // max_events counts the converted events, first_event all events of the file.
+    std::shared_ptr<const SOCO::EventFilter> filter;
+    // Writes the calibrated energy of each hit if set
+    std::shared_ptr<const SOCO::Calibration> calibration;
+    // Writes hit_idx, the index of the id of each hit in id_dictionary, see SOCO::IdDictionary
+    // Without id_dictionary, it is built from the ids of the input files first. The ids of
+    // id_dictionary, or otherwise of all converted hits, are stored in the UserInfo of the trees,
+    // after merging chunks or parts from the ids collected while converting them.
+    // hit_idx is UChar_t for dictionaries of up to 256 ids, which must contain all converted ids.
+    bool id_index = false;
+    std::shared_ptr<const SOCO::IdDictionary> id_dictionary;
+    // Rebuild the events of time-ordered inputs from their hits with a new coincidence window, in
+    // units of the hit timestamps, see SOCO::EventBuilder. reorder_window 0: from the input events
+    bool rebuild            = false;
+    uint64_t rebuild_window = 0;
+    uint64_t reorder_window = 0;
+
+    // Value for TFile::SetCompressionSettings, -1 to keep the ROOT default
+    int compressionSettings() const;
+};
 
 class Soco2Root
 {
     public:
-    Soco2Root(const std::string& in, const std::string& out);
+    Soco2Root(const std::string& in,
+              const std::string& out,
+              const Soco2RootOptions& opts = Soco2RootOptions());
+    // Merges the events of all inputs, each sorted by time, into one time-ordered output tree
+    Soco2Root(const std::vector<std::string>& ins,
+              const std::string& out,
+              const Soco2RootOptions& opts = Soco2RootOptions());
     ~Soco2Root()                = default;             // Destructor
     Soco2Root(const Soco2Root&) = delete;              // Copy constructor
     Soco2Root(Soco2Root&&)      = delete;              // Move constructor
@@ -34,9 +161,44 @@ class Soco2Root
 
     void process();
 
+    // Converts into a ROOT file in memory instead of the output file and returns its contents
+    // The output filename is only used as name of the memory file. Chunks are not supported.
+    std::vector<char> processToMemory();
+
+    // Ends all conversions in follow mode after the events available so far
+    // Async signal safe
+    static void stopFollowing();
+
+    // Dictionary of the ids of all hits in the files that are kept by options.filter
+    static std::shared_ptr<const SOCO::IdDictionary> scanIds(const std::vector<std::string>& files,
+                                                             const Soco2RootOptions& options);
+
+    // Replaces the ids in the UserInfo of the trees in filename, e.g. after merging trees with
+    // the ids of their parts
+    static void storeIds(const std::string& filename, const SeenIds& ids);
+
+    // Timings and counts, available after process
+    const ConversionStats& getStats() const { return stats; }
+
+    // Ids of the converted hits, available after process without options.id_dictionary
+    const SeenIds& getSeenIds() const { return seen_ids; }
+
     private:
+    void convert(SOCO::EventReader& eventReader);
+    void follow();
+    void processTimeOrdered();
+    void processChunks(const SOCO::EventReader& eventReader);
+    // Writes the events rebuilt from the events of next, same as SOCO::EventReader::readBatch
+    void rebuildEvents(const std::function<size_t(SOCO::EventBatch&, size_t)>& next);
+
     std::string input;
+    std::vector<std::string> time_ordered_inputs;
     std::string output;
+    Soco2RootOptions options;
+    ConversionStats stats;
+    SeenIds seen_ids;
+    // set during processToMemory
+    std::vector<char>* image;
 };
 
 #endif // SOCO2ROOT_SOCO2ROOT_H
@@ -0,0 +1,40 @@
+#ifndef SOCO_THREADSAVECOUT_HH
+#define SOCO_THREADSAVECOUT_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <mutex>
+#include <string>
+
+namespace SOCO
+{
+
+// Prints x as a line of its own, also when several threads print at the same time
+inline void threadsavecout(const std::string& x)
+{
+    static std::mutex m;
+    std::lock_guard<std::mutex> mylock(m);
+    std::cout << x << std::endl;
+}
+
+} // namespace SOCO
+
+#endif // SOCO_THREADSAVECOUT_HH
@@ -0,0 +1,264 @@
+#include "Verify.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "EventReader.h"
+
+namespace SOCO
+{
+
+namespace
+{
+
+void count(const EventView& view, const bool checksum, VerifyResult& result)
+{
+    const size_t multiplicity = view.multiplicity();
+    ++result.events;
+    result.hits += multiplicity;
+    ++result.multiplicities[multiplicity];
+    if (checksum)
+    {
+        EventChecksum event(view.trigger_id());
+        for (const HitView hit : view)
+        {
+            event.add(hit.id(), hit.adc(), hit.timestamp());
+        }
+        result.checksum += event.value();
+    }
+}
+
+// Counts the events of chunk, returns the end of its last complete event
+size_t verifyChunk(const EventReader& reader,
+                   const EventChunk& chunk,
+                   const bool checksum,
+                   VerifyResult& result)
+{
+    size_t pos = chunk.begin;
+    EventView view;
+    while (reader.getEventViewAt(view, pos, chunk.end))
+    {
+        count(view, checksum, result);
+    }
+    return pos;
+}
+
+// Sum of EventChecksum over the events of chunk
+uint64_t checksumChunk(const EventReader& reader, const EventChunk& chunk)
+{
+    uint64_t sum = 0;
+    size_t pos   = chunk.begin;
+    EventView view;
+    while (reader.getEventViewAt(view, pos, chunk.end))
+    {
+        EventChecksum event(view.trigger_id());
+        for (const HitView hit : view)
+        {
+            event.add(hit.id(), hit.adc(), hit.timestamp());
+        }
+        sum += event.value();
+    }
+    return sum;
+}
+
+// Runs task(i) for i < n, on a thread of its own if n > 1
+template <class Task>
+void parallel(const size_t n, Task task)
+{
+    if (n == 1)
+    {
+        task(0);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < n; ++i)
+    {
+        workers.emplace_back([&task, i]() { task(i); });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+// Up to n chunks that start at indexed events, so no walk over the framing is needed to split
+// The last chunk ends at the end of the file, the others at the next chunk.
+std::vector<EventChunk>
+chunksFromIndex(const EventReader& reader, const EventIndex& index, size_t n)
+{
+    const uint64_t entries = (index.numberOfEvents() + index.stride() - 1) / index.stride();
+    n                      = static_cast<size_t>(std::min<uint64_t>(n, entries));
+    std::vector<EventChunk> chunks;
+    for (size_t k = 0; k < n; ++k)
+    {
+        const uint64_t first = k * entries / n * index.stride();
+        const uint64_t last  = (k + 1) * entries / n * index.stride();
+        EventChunk chunk;
+        chunk.begin       = index.offsetBefore(first);
+        chunk.end         = (k + 1 < n) ? index.offsetBefore(last) : reader.mappedBytes();
+        chunk.first_event = first;
+        chunk.events      = std::min(last, index.numberOfEvents()) - first;
+        chunks.push_back(chunk);
+    }
+    return chunks;
+}
+
+// Splits the file at the indexed events and counts the chunks in parallel
+// Returns the end of the last complete event.
+size_t verifyIndexed(const EventReader& reader,
+                     const EventIndex& index,
+                     const size_t threads,
+                     const bool checksum,
+                     VerifyResult& result)
+{
+    const auto chunks = chunksFromIndex(reader, index, threads);
+    std::vector<VerifyResult> parts(chunks.size());
+    std::vector<size_t> ends(chunks.size());
+    parallel(chunks.size(),
+             [&](const size_t i) { ends[i] = verifyChunk(reader, chunks[i], checksum, parts[i]); });
+
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        if (i + 1 < chunks.size() && ends[i] != chunks[i].end)
+        {
+            throw std::runtime_error("SOCO::verify - the index of " + reader.getFilename() +
+                                     " does not match its events");
+        }
+        result.events += parts[i].events;
+        result.hits += parts[i].hits;
+        result.checksum += parts[i].checksum;
+        for (size_t m = 0; m < result.multiplicities.size(); ++m)
+        {
+            result.multiplicities[m] += parts[i].multiplicities[m];
+        }
+    }
+    return chunks.empty() ? reader.dataOffset() : ends.back();
+}
+
+// Counts all events in one walk over the framing, which also splits the file into up to threads
+// chunks. Only the checksum of the chunks is computed in parallel afterwards.
+// Returns the end of the last complete event.
+size_t verifySequential(const EventReader& reader,
+                        const size_t threads,
+                        const bool checksum,
+                        VerifyResult& result)
+{
+    const size_t begin  = reader.dataOffset();
+    const size_t end    = reader.mappedBytes();
+    const size_t target = (end - std::min(begin, end)) / threads + 1;
+    std::vector<EventChunk> chunks;
+    EventChunk chunk{begin, begin, 0, 0};
+    size_t pos = begin;
+    EventView view;
+    while (reader.getEventViewAt(view, pos, end))
+    {
+        count(view, false, result);
+        if (pos - chunk.begin >= target)
+        {
+            chunk.end    = pos;
+            chunk.events = result.events - chunk.first_event;
+            chunks.push_back(chunk);
+            chunk = EventChunk{pos, pos, result.events, 0};
+        }
+    }
+    if (result.events > chunk.first_event)
+    {
+        chunk.end    = pos;
+        chunk.events = result.events - chunk.first_event;
+        chunks.push_back(chunk);
+    }
+
+    if (checksum && !chunks.empty())
+    {
+        std::vector<uint64_t> sums(chunks.size());
+        parallel(chunks.size(),
+                 [&](const size_t i) { sums[i] = checksumChunk(reader, chunks[i]); });
+        for (const uint64_t sum : sums)
+        {
+            result.checksum += sum;
+        }
+    }
+    return pos;
+}
+
+// One sequential pass through the ring buffers of a streamed file
+VerifyResult verifyStream(EventReader& reader, const bool checksum)
+{
+    VerifyResult result;
+    result.header_events = reader.numberOfEvents();
+    result.has_checksum  = checksum;
+    EventView view;
+    while (reader.getNextEventView(view))
+    {
+        count(view, checksum, result);
+    }
+    const size_t end       = std::min(reader.position(), reader.mappedBytes());
+    result.truncated_bytes = reader.mappedBytes() - end;
+    return result;
+}
+
+} // namespace {anonymous}
+
+std::string VerifyResult::summary() const
+{
+    char line[256];
+    std::snprintf(line,
+                  sizeof(line),
+                  "%" PRIu64 " events (header: %" PRIu64 "), %" PRIu64 " hits, %" PRIu64
+                  " truncated bytes",
+                  events,
+                  header_events,
+                  hits,
+                  truncated_bytes);
+    std::string result = line;
+    if (has_checksum)
+    {
+        std::snprintf(line, sizeof(line), ", checksum %016" PRIx64, checksum);
+        result += line;
+    }
+    result += ok() ? ", OK" : ", FAILED";
+    for (size_t m = 0; m < multiplicities.size(); ++m)
+    {
+        if (multiplicities[m])
+        {
+            std::snprintf(line, sizeof(line), "\n  mult %3zu: %" PRIu64, m, multiplicities[m]);
+            result += line;
+        }
+    }
+    return result;
+}
+
+VerifyResult verify(EventReader& reader, const size_t threads, const bool checksum)
+{
+    if (reader.isStreamed())
+    {
+        if (reader.position() != reader.dataOffset())
+        {
+            throw std::runtime_error("SOCO::verify - the stream is not at the first event");
+        }
+        return verifyStream(reader, checksum);
+    }
+
+    VerifyResult result;
+    result.header_events = reader.numberOfEvents();
+    result.has_checksum  = checksum;
+    // the framing can only be walked from the start, unless a saved index gives the split
+    const size_t n = std::max<size_t>(threads, 1);
+    size_t end;
+    if (reader.loadIndex())
+    {
+        end = verifyIndexed(reader, reader.index(), n, checksum, result);
+    }
+    else
+    {
+        end = verifySequential(reader, n, checksum, result);
+    }
+    result.truncated_bytes = reader.mappedBytes() - std::min(end, reader.mappedBytes());
+    return result;
+}
+
+} // namespace SOCO
@@ -0,0 +1,94 @@
+#ifndef SOCO_VERIFY_HH
+#define SOCO_VERIFY_HH
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace SOCO
+{
+
+class EventReader;
+
+// Checksum of the trigger id and the hits of one event, in the order of the hits
+// The checksum of a file is the sum of the checksums of all its events, so it does not depend on
+// the order of the events. It can be recomputed from a converted tree, e.g. for the flat layout:
+//   SOCO::EventChecksum checksum(trigger_id);
+//   for (UInt_t h = 0; h < mult; ++h) checksum.add(hit_id[h], hit_adc[h], hit_ts[h]);
+//   sum += checksum.value();
+class EventChecksum
+{
+    public:
+    explicit EventChecksum(const uint16_t trigger_id)
+        : state_{mix(trigger_id + UINT64_C(0x9e3779b97f4a7c15))}
+    {
+    }
+
+    void add(const uint16_t id, const uint16_t adc, const uint64_t timestamp)
+    {
+        state_ = mix(state_ ^ timestamp);
+        state_ = mix(state_ ^ (static_cast<uint64_t>(id) | static_cast<uint64_t>(adc) << 16));
+    }
+
+    uint64_t value() const { return state_; }
+
+    private:
+    // splitmix64 finalizer
+    static uint64_t mix(uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+        x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+        return x ^ (x >> 31);
+    }
+
+    uint64_t state_;
+};
+
+// Result of verify
+struct VerifyResult
+{
+    uint64_t header_events   = 0; // EventHeader::event_count
+    uint64_t events          = 0; // complete events in the file
+    uint64_t hits            = 0;
+    uint64_t truncated_bytes = 0; // after the last complete event
+    std::array<uint64_t, 256> multiplicities{};
+    bool has_checksum = false;
+    uint64_t checksum = 0; // sum of EventChecksum over all events
+
+    bool ok() const { return events == header_events && truncated_bytes == 0; }
+
+    // One line with the counts, followed by the multiplicity distribution
+    std::string summary() const;
+};
+
+// Walks the framing of all events of a mapped file. With a valid saved index (see
+// EventReader::loadIndex), the file is split at indexed events into chunks counted on up to threads
+// threads. Otherwise one sequential walk counts all events and only the checksum is computed on up
+// to threads threads. Only the multiplicity bytes are read, unless the checksum is computed. No
+// filter is applied. Streamed files are read once from their first event on a single thread, which
+// consumes the stream of reader.
+VerifyResult verify(EventReader& reader, size_t threads, bool checksum);
+
+} // namespace SOCO
+
+#endif // SOCO_VERIFY_HH
@@ -0,0 +1,190 @@
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Converts the same file concurrently on several threads and compares every output with a serial
+// conversion and with the events of the input file, for all output layouts
+
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include "EventReader.h"
+#include "RelativeTimestamps.h"
+#include "Soco2Root.h"
+#include "TestUtils.h"
+
+namespace
+{
+
+constexpr int CONCURRENT = 8;
+
+// All entries of the tree "ttree", in any layout
+std::vector<SOCO::Event> readTree(const std::string& filename)
+{
+    TFile file(filename.c_str(), "READ");
+    TTree* ttree = nullptr;
+    file.GetObject("ttree", ttree);
+    CHECK(ttree != nullptr);
+
+    std::vector<SOCO::Event> events;
+    const Long64_t entries = ttree->GetEntries();
+    if (ttree->GetBranch("events"))
+    {
+        SOCO::Event* event = nullptr;
+        ttree->SetBranchAddress("events", &event);
+        for (Long64_t i = 0; i < entries; ++i)
+        {
+            ttree->GetEntry(i);
+            events.push_back(*event);
+        }
+        ttree->ResetBranchAddresses();
+        delete event;
+        return events;
+    }
+
+    constexpr size_t MAX_MULTIPLICITY = std::numeric_limits<uint8_t>::max();
+    UShort_t trigger_id;
+    ULong64_t timestamp;
+    UInt_t mult;
+    UShort_t hit_id[MAX_MULTIPLICITY];
+    UShort_t hit_adc[MAX_MULTIPLICITY];
+    ULong64_t hit_ts[MAX_MULTIPLICITY];
+    Int_t hit_dt[MAX_MULTIPLICITY];
+    ULong64_t hit_ts_escaped[MAX_MULTIPLICITY];
+    const bool relative = ttree->GetBranch("hit_dt") != nullptr;
+    ttree->SetBranchAddress("trigger_id", &trigger_id);
+    ttree->SetBranchAddress("timestamp", &timestamp);
+    ttree->SetBranchAddress("mult", &mult);
+    ttree->SetBranchAddress("hit_id", hit_id);
+    ttree->SetBranchAddress("hit_adc", hit_adc);
+    if (relative)
+    {
+        ttree->SetBranchAddress("hit_dt", hit_dt);
+        ttree->SetBranchAddress("hit_ts_escaped", hit_ts_escaped);
+    }
+    else
+    {
+        ttree->SetBranchAddress("hit_ts", hit_ts);
+    }
+    for (Long64_t i = 0; i < entries; ++i)
+    {
+        ttree->GetEntry(i);
+        if (relative)
+        {
+            SOCO::decodeTimestamps(timestamp, hit_dt, mult, hit_ts_escaped, hit_ts);
+        }
+        SOCO::Event event;
+        event.trigger_id = trigger_id;
+        event.timestamp  = timestamp;
+        for (UInt_t h = 0; h < mult; ++h)
+        {
+            event.hits.emplace_back(hit_id[h], hit_adc[h], hit_ts[h]);
+        }
+        events.push_back(std::move(event));
+    }
+    ttree->ResetBranchAddresses();
+    return events;
+}
+
+void convert(const std::string& input, const std::string& output, const OutputLayout layout)
+{
+    Soco2RootOptions options;
+    options.layout = layout;
+    Soco2Root s2r(input, output, options);
+    s2r.process();
+}
+
+void testLayout(const std::string& input,
+                const std::vector<SOCO::Event>& expected,
+                const OutputLayout layout)
+{
+    const std::string reference = input + ".serial.root";
+    convert(input, reference, layout);
+    CHECK(test::sameEvents(readTree(reference), expected));
+
+    std::vector<std::string> outputs;
+    std::vector<std::thread> workers;
+    std::vector<std::string> errors(CONCURRENT);
+    for (int i = 0; i < CONCURRENT; ++i)
+    {
+        outputs.push_back(input + ".concurrent" + std::to_string(i) + ".root");
+    }
+    for (int i = 0; i < CONCURRENT; ++i)
+    {
+        workers.emplace_back([&, i]() {
+            try
+            {
+                convert(input, outputs[i], layout);
+            }
+            catch (const std::exception& e)
+            {
+                errors[i] = e.what();
+            }
+        });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    for (int i = 0; i < CONCURRENT; ++i)
+    {
+        CHECK(errors[i].empty());
+        CHECK(test::sameEvents(readTree(outputs[i]), expected));
+        std::remove(outputs[i].c_str());
+    }
+    std::remove(reference.c_str());
+}
+
+} // namespace {anonymous}
+
+int main()
+{
+    return test::run("ConcurrentConversion", []() {
+        const std::string input = "concurrent_conversion.evt";
+        // escaped relative timestamps at the start and at the end of the file
+        std::vector<SOCO::Event> events = test::escapedEvents();
+        for (const SOCO::Event& event : test::randomEvents(50000, 20, 1))
+        {
+            events.push_back(event);
+        }
+        for (const SOCO::Event& event : test::escapedEvents())
+        {
+            events.push_back(event);
+        }
+        test::writeEventFile(input, events);
+
+        // with the event timestamps of the trigger hits
+        SOCO::EventReader reader;
+        reader.mapFile(input);
+        const std::vector<SOCO::Event> expected = reader.readAllEvents();
+        CHECK(expected.size() == events.size());
+        CHECK(expected.front().timestamp == UINT64_C(1) << 40);
+
+        testLayout(input, expected, OutputLayout::Event);
+        testLayout(input, expected, OutputLayout::Flat);
+        testLayout(input, expected, OutputLayout::Relative);
+        std::remove(input.c_str());
+    });
+}
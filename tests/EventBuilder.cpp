@@ -0,0 +1,281 @@
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Rebuilds known hit streams with SOCO::EventBuilder and compares the events with a plain
+// reference: all hits sorted, identical hits once, grouped from the first hit of each event
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "EventBatch.h"
+#include "EventBuilder.h"
+#include "TestUtils.h"
+
+namespace
+{
+
+constexpr size_t MAX_MULTIPLICITY = 255;
+
+// Input batches of up to max_events of events, like EventReader::readBatch
+SOCO::EventBuilder::NextBatch source(const std::vector<SOCO::Event>& events)
+{
+    size_t next = 0;
+    return [&events, next](SOCO::EventBatch& batch, const size_t max_events) mutable {
+        batch.clear();
+        while (batch.events < max_events && next < events.size())
+        {
+            const SOCO::Event& event = events[next++];
+            std::vector<uint16_t> ids;
+            std::vector<uint16_t> adcs;
+            std::vector<uint64_t> timestamps;
+            for (const SOCO::Hit& hit : event.hits)
+            {
+                ids.push_back(hit.id);
+                adcs.push_back(hit.adc);
+                timestamps.push_back(hit.timestamp);
+            }
+            batch.append(event.trigger_id,
+                         event.timestamp,
+                         ids.data(),
+                         adcs.data(),
+                         timestamps.data(),
+                         event.hits.size());
+        }
+        return batch.events;
+    };
+}
+
+bool earlier(const SOCO::Hit& a, const SOCO::Hit& b)
+{
+    return a.timestamp < b.timestamp ||
+           (a.timestamp == b.timestamp && (a.id < b.id || (a.id == b.id && a.adc < b.adc)));
+}
+
+std::vector<SOCO::Event> reference(const std::vector<SOCO::Event>& input,
+                                   const uint64_t window,
+                                   uint64_t& duplicates)
+{
+    std::vector<SOCO::Hit> hits;
+    for (const SOCO::Event& event : input)
+    {
+        hits.insert(hits.end(), event.hits.begin(), event.hits.end());
+    }
+    std::sort(hits.begin(), hits.end(), earlier);
+    const size_t all = hits.size();
+    hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+    duplicates = all - hits.size();
+
+    std::vector<SOCO::Event> events;
+    for (size_t i = 0; i < hits.size();)
+    {
+        SOCO::Event event;
+        event.trigger_id = hits[i].id;
+        event.timestamp  = hits[i].timestamp;
+        while (i < hits.size() && event.hits.size() < MAX_MULTIPLICITY &&
+               hits[i].timestamp - event.timestamp <= window)
+        {
+            event.hits.push_back(hits[i++]);
+        }
+        events.push_back(std::move(event));
+    }
+    return events;
+}
+
+struct Rebuilt
+{
+    std::vector<SOCO::Event> events;
+    uint64_t unordered;
+    uint64_t duplicates;
+};
+
+Rebuilt rebuild(const std::vector<SOCO::Event>& input,
+                const uint64_t window,
+                const uint64_t reorder_window,
+                const size_t read_ahead,
+                const size_t batch_size)
+{
+    SOCO::EventBuilder builder(source(input), window, reorder_window, read_ahead);
+    Rebuilt rebuilt;
+    SOCO::EventBatch batch;
+    while (builder.readBatch(batch, batch_size))
+    {
+        for (size_t i = 0; i < batch.events; ++i)
+        {
+            SOCO::Event event;
+            event.trigger_id = batch.trigger_ids[i];
+            event.timestamp  = batch.event_timestamps[i];
+            for (size_t h = batch.offsets[i]; h < batch.offsets[i + 1]; ++h)
+            {
+                event.hits.emplace_back(batch.ids[h], batch.adcs[h], batch.timestamps[h]);
+            }
+            rebuilt.events.push_back(std::move(event));
+        }
+    }
+    rebuilt.unordered  = builder.unorderedHits();
+    rebuilt.duplicates = builder.duplicateHits();
+    return rebuilt;
+}
+
+// Same events as the reference for all refill and output batch sizes, which moves the refills to
+// different points of the stream
+std::vector<SOCO::Event> check(const std::vector<SOCO::Event>& input,
+                               const uint64_t window,
+                               const uint64_t reorder_window)
+{
+    uint64_t duplicates                     = 0;
+    const std::vector<SOCO::Event> expected = reference(input, window, duplicates);
+    for (const size_t read_ahead : {1, 3, 4096})
+    {
+        for (const size_t batch_size : {1, 7, 4096})
+        {
+            const Rebuilt rebuilt = rebuild(input, window, reorder_window, read_ahead, batch_size);
+            CHECK(rebuilt.unordered == 0);
+            CHECK(rebuilt.duplicates == duplicates);
+            CHECK(test::sameEvents(rebuilt.events, expected));
+        }
+    }
+    return expected;
+}
+
+size_t countHits(const std::vector<SOCO::Event>& events)
+{
+    size_t hits = 0;
+    for (const SOCO::Event& event : events)
+    {
+        hits += event.hits.size();
+    }
+    return hits;
+}
+
+// Events sorted by time whose hits overlap with the neighbouring events by up to 300
+void testWindows()
+{
+    const auto input = test::randomEvents(3000, 20, 24);
+    for (const uint64_t window : {0, 1, 50, 300, 5000})
+    {
+        check(input, window, 1000);
+    }
+}
+
+// Without reorder window, twice the longest event so far: the first event is the widest
+void testAdaptiveReorderWindow()
+{
+    std::vector<SOCO::Event> input(1);
+    input[0].trigger_id = 1;
+    input[0].hits.emplace_back(1, 10, 0);
+    input[0].hits.emplace_back(2, 11, 1000);
+    for (const SOCO::Event& event : test::randomEvents(3000, 20, 25))
+    {
+        input.push_back(event);
+    }
+    check(input, 100, 0);
+
+    // too small for the overlapping events read one by one: the late hits are counted and still
+    // converted once
+    const Rebuilt rebuilt = rebuild(input, 100, 1, 1, 4096);
+    CHECK(rebuilt.unordered > 0);
+    CHECK(countHits(rebuilt.events) == countHits(input));
+}
+
+// Consecutive input events share hits, e.g. from an overlapping original event building
+void testDuplicates()
+{
+    std::vector<SOCO::Event> input;
+    uint64_t copies = 0;
+    for (uint64_t k = 0; k < 500; ++k)
+    {
+        SOCO::Event event;
+        event.trigger_id = 3;
+        if (!input.empty())
+        {
+            const auto& previous = input.back().hits;
+            event.hits.insert(event.hits.end(), previous.end() - 2, previous.end());
+            copies += 2;
+        }
+        for (uint64_t h = 0; h < 4; ++h)
+        {
+            event.hits.emplace_back(
+                static_cast<uint16_t>(h), static_cast<uint16_t>(k), 100 * k + 10 * h);
+        }
+        input.push_back(event);
+    }
+    uint64_t duplicates = 0;
+    reference(input, 15, duplicates);
+    CHECK(duplicates == copies);
+    for (const uint64_t window : {0, 15, 45, 250})
+    {
+        check(input, window, 0);
+    }
+}
+
+// One input event spans many windows and is split up
+void testWideEvent()
+{
+    std::vector<SOCO::Event> input = test::randomEvents(10, 5, 26);
+    SOCO::Event wide;
+    wide.trigger_id = 9;
+    const uint64_t start = input.back().hits.back().timestamp + 100000;
+    for (uint16_t h = 0; h < 200; ++h)
+    {
+        wide.hits.emplace_back(h, h, start + 10 * h);
+    }
+    input.push_back(wide);
+    input.back().hits.emplace_back(1, 1, start + 5);
+
+    const auto events = check(input, 100, 0);
+    size_t parts = 0;
+    for (const SOCO::Event& event : events)
+    {
+        parts += (event.timestamp >= start);
+    }
+    // windows start at every 110th tick of the 1990 ticks
+    CHECK(parts == 19);
+}
+
+// Two input events with 200 hits each within one window make more than 255 hits
+void testMultiplicityLimit()
+{
+    std::vector<SOCO::Event> input(2);
+    for (uint16_t e = 0; e < 2; ++e)
+    {
+        input[e].trigger_id = e;
+        for (uint16_t h = 0; h < 200; ++h)
+        {
+            input[e].hits.emplace_back(e, h, 1000 + h + e);
+        }
+    }
+    const auto events = check(input, 1000, 0);
+    CHECK(events.size() == 2);
+    CHECK(events[0].hits.size() == MAX_MULTIPLICITY);
+    CHECK(events[1].hits.size() == 400 - MAX_MULTIPLICITY);
+}
+
+} // namespace {anonymous}
+
+int main()
+{
+    return test::run("EventBuilder", []() {
+        testWindows();
+        testAdaptiveReorderWindow();
+        testDuplicates();
+        testWideEvent();
+        testMultiplicityLimit();
+    });
+}
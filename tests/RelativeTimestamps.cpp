@@ -0,0 +1,117 @@
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Encodes hit timestamps relative to the event timestamp and decodes them again, and the other way
+// round, for differences around the int32 limits where the timestamps have to be escaped
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "RelativeTimestamps.h"
+#include "TestUtils.h"
+
+namespace
+{
+
+constexpr int64_t INT32_LOW  = std::numeric_limits<int32_t>::min();
+constexpr int64_t INT32_HIGH = std::numeric_limits<int32_t>::max();
+
+// timestamps -> dt, escaped -> timestamps
+void testEncode(const uint64_t event_timestamp)
+{
+    const std::vector<int64_t> deltas = {INT32_LOW - 1,
+                                         INT32_LOW,
+                                         INT32_LOW + 1,
+                                         -1,
+                                         0,
+                                         1,
+                                         INT32_HIGH,
+                                         INT32_HIGH + 1,
+                                         INT64_C(1) << 40,
+                                         -(INT64_C(1) << 40)};
+    const size_t n = deltas.size();
+    std::vector<uint64_t> timestamps(n);
+    size_t expected_escaped = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        timestamps[i] = event_timestamp + static_cast<uint64_t>(deltas[i]);
+        expected_escaped += (deltas[i] <= INT32_LOW || deltas[i] > INT32_HIGH);
+    }
+
+    std::vector<int32_t> dt(n);
+    std::vector<uint64_t> escaped(n);
+    const size_t n_escaped =
+        SOCO::encodeTimestamps(event_timestamp, timestamps.data(), n, dt.data(), escaped.data());
+    CHECK(n_escaped == expected_escaped);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const bool fits = (deltas[i] > INT32_LOW && deltas[i] <= INT32_HIGH);
+        CHECK(fits ? dt[i] == deltas[i] : dt[i] == SOCO::ESCAPED_TIMESTAMP);
+    }
+
+    std::vector<uint64_t> decoded(n);
+    CHECK(SOCO::decodeTimestamps(event_timestamp, dt.data(), n, escaped.data(), decoded.data()) ==
+          n_escaped);
+    CHECK(decoded == timestamps);
+}
+
+// dt, escaped -> timestamps -> dt, escaped
+void testDecode(const uint64_t event_timestamp)
+{
+    const std::vector<int32_t> dt = {std::numeric_limits<int32_t>::max(),
+                                     SOCO::ESCAPED_TIMESTAMP,
+                                     std::numeric_limits<int32_t>::min() + 1,
+                                     0,
+                                     SOCO::ESCAPED_TIMESTAMP,
+                                     -1};
+    // too far from the event timestamp for dt, in both directions
+    const std::vector<uint64_t> escaped = {event_timestamp + (UINT64_C(1) << 31),
+                                           event_timestamp - (UINT64_C(1) << 31)};
+    const size_t n = dt.size();
+
+    std::vector<uint64_t> timestamps(n);
+    CHECK(SOCO::decodeTimestamps(event_timestamp, dt.data(), n, escaped.data(), timestamps.data()) ==
+          escaped.size());
+    CHECK(timestamps[1] == escaped[0] && timestamps[4] == escaped[1]);
+
+    std::vector<int32_t> encoded(n);
+    std::vector<uint64_t> encoded_escaped(n);
+    CHECK(SOCO::encodeTimestamps(
+              event_timestamp, timestamps.data(), n, encoded.data(), encoded_escaped.data()) ==
+          escaped.size());
+    CHECK(encoded == dt);
+    encoded_escaped.resize(escaped.size());
+    CHECK(encoded_escaped == escaped);
+}
+
+} // namespace {anonymous}
+
+int main()
+{
+    return test::run("RelativeTimestamps", []() {
+        // including events without a trigger hit (0) and differences that wrap around
+        for (const uint64_t event_timestamp :
+             {UINT64_C(0), UINT64_C(1) << 40, std::numeric_limits<uint64_t>::max() - 5})
+        {
+            testEncode(event_timestamp);
+            testDecode(event_timestamp);
+        }
+    });
+}
@@ -0,0 +1,222 @@
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Compares the kernels selected with SOCO_SIMD with the scalar code on the same buffers
+// Registered once per value of SOCO_SIMD, so every kernel the CPU supports is checked.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Calibration.h"
+#include "EventReader.h"
+#include "HitKernels.h"
+#include "TestUtils.h"
+
+namespace
+{
+
+// n random hit records that end directly before an inaccessible page, so any read beyond the
+// readable bytes crashes
+class GuardedRecords
+{
+    public:
+    explicit GuardedRecords(const size_t n, std::mt19937_64& random)
+        : page_(static_cast<size_t>(sysconf(_SC_PAGESIZE)))
+        , size_((n * SOCO::HIT_SIZE / page_ + 2) * page_)
+        , memory_(static_cast<uint8_t*>(
+              mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)))
+    {
+        CHECK(memory_ != MAP_FAILED);
+        CHECK(mprotect(memory_ + size_ - page_, page_, PROT_NONE) == 0);
+        data_ = memory_ + size_ - page_ - n * SOCO::HIT_SIZE;
+        for (size_t i = 0; i < n * SOCO::HIT_SIZE; ++i)
+        {
+            data_[i] = static_cast<uint8_t>(random());
+        }
+    }
+
+    ~GuardedRecords() { munmap(memory_, size_); }
+
+    GuardedRecords(const GuardedRecords&) = delete;
+    GuardedRecords& operator=(const GuardedRecords&) = delete;
+
+    const uint8_t* data() const { return data_; }
+
+    private:
+    size_t page_;
+    size_t size_;
+    uint8_t* memory_;
+    uint8_t* data_;
+};
+
+struct Hits
+{
+    explicit Hits(const size_t n)
+        : ids(n)
+        , adcs(n)
+        , timestamps(n)
+    {
+    }
+
+    bool operator==(const Hits& rhs) const
+    {
+        return ids == rhs.ids && adcs == rhs.adcs && timestamps == rhs.timestamps;
+    }
+
+    std::vector<uint16_t> ids;
+    std::vector<uint16_t> adcs;
+    std::vector<uint64_t> timestamps;
+};
+
+// Decodes n of the records at src with the selected and the scalar kernel
+void compareDeinterleave(const uint8_t* src, const size_t n, const size_t readable)
+{
+    Hits simd(n);
+    Hits scalar(n);
+    SOCO::deinterleaveHits(
+        src, n, readable, simd.ids.data(), simd.adcs.data(), simd.timestamps.data());
+    SOCO::deinterleaveHitsScalar(
+        src, n, readable, scalar.ids.data(), scalar.adcs.data(), scalar.timestamps.data());
+    CHECK(simd == scalar);
+}
+
+void testDeinterleave()
+{
+    std::mt19937_64 random(6);
+    // all tail lengths of the 4 and 8 record loops, ending directly at the guard page
+    for (size_t n = 0; n <= 40; ++n)
+    {
+        GuardedRecords records(n, random);
+        compareDeinterleave(records.data(), n, n * SOCO::HIT_SIZE);
+    }
+    // more readable data than records, at every alignment
+    GuardedRecords records(1000, random);
+    for (size_t offset = 0; offset < 16; ++offset)
+    {
+        for (size_t n : {1, 7, 8, 9, 100, 500})
+        {
+            const size_t readable = 1000 * SOCO::HIT_SIZE - offset;
+            const size_t records_n = std::min(n, readable / SOCO::HIT_SIZE);
+            compareDeinterleave(records.data() + offset, records_n, readable);
+        }
+    }
+}
+
+// Calibration::apply with the selected kernel against the scalar Calibration::energy
+void testCalibration()
+{
+    std::mt19937_64 random(20);
+    SOCO::Calibration calibration;
+    // every other id, up to cubic; the others are uncalibrated
+    for (size_t id = 0; id < SOCO::Calibration::IDS; id += 2)
+    {
+        std::vector<double> coefficients(1 + id % 4);
+        for (double& c : coefficients)
+        {
+            c = static_cast<double>(random() % 2000001) / 1e6 - 1;
+        }
+        calibration.set(static_cast<uint16_t>(id), coefficients);
+    }
+
+    // all tail lengths of the 4 hit loop and a large batch
+    for (size_t n : {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 4099})
+    {
+        std::vector<uint16_t> ids(n);
+        std::vector<uint16_t> adcs(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            ids[i]  = static_cast<uint16_t>(random());
+            adcs[i] = static_cast<uint16_t>(random());
+        }
+        std::vector<float> energies(n);
+        calibration.apply(ids.data(), adcs.data(), n, energies.data());
+        for (size_t i = 0; i < n; ++i)
+        {
+            CHECK(energies[i] == static_cast<float>(calibration.energy(ids[i], adcs[i])));
+        }
+    }
+}
+
+// A mapped file that ends exactly at a page boundary, decoded by readBatch with the selected
+// kernel and by readAllEvents without any kernel
+void testEndOfMapping(const std::string& filename)
+{
+    const auto events          = test::randomEvents(2000, 30, 7);
+    test::writeEventFile(filename, events);
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    {
+        SOCO::EventReader reader;
+        reader.mapFile(filename);
+        // pad the metadata, so the file size is a multiple of the page size
+        const size_t size    = reader.mappedBytes() + sizeof(SOCO::EventMetadataHeader);
+        const size_t padding = (page - size % page) % page;
+        test::writeEventFile(filename, events, {std::string(padding, 'x')});
+    }
+
+    SOCO::EventReader reader;
+    reader.mapFile(filename);
+    CHECK(reader.mappedBytes() % page == 0);
+    const std::vector<SOCO::Event> expected = reader.readAllEvents();
+    CHECK(expected.size() == events.size());
+
+    SOCO::EventBatch batch;
+    size_t event = 0;
+    while (reader.readBatch(batch, 333))
+    {
+        for (size_t i = 0; i < batch.events; ++i, ++event)
+        {
+            CHECK(batch.trigger_ids[i] == expected[event].trigger_id);
+            CHECK(batch.event_timestamps[i] == expected[event].timestamp);
+            CHECK(batch.multiplicity(i) == expected[event].hits.size());
+            for (size_t h = 0; h < batch.multiplicity(i); ++h)
+            {
+                const SOCO::Hit& hit = expected[event].hits[h];
+                const size_t k       = batch.offsets[i] + h;
+                CHECK(batch.ids[k] == hit.id && batch.adcs[k] == hit.adc &&
+                      batch.timestamps[k] == hit.timestamp);
+            }
+        }
+    }
+    CHECK(event == expected.size());
+    std::remove(filename.c_str());
+}
+
+} // namespace {anonymous}
+
+int main()
+{
+    const char* env        = std::getenv("SOCO_SIMD");
+    const std::string simd = env ? env : "";
+    std::cout << "SOCO_SIMD=" << simd << ": deinterleaveHits " << SOCO::deinterleaveHitsKernel()
+              << ", calibration " << SOCO::calibrationKernel() << std::endl;
+    return test::run("SimdKernels", [&simd]() {
+        testDeinterleave();
+        testCalibration();
+        // one file per kernel, the tests may run in parallel
+        testEndOfMapping("simd_kernels_" + simd + ".evt");
+    });
+}
@@ -0,0 +1,143 @@
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Reads generated files through the bounded-memory stream and compares every event and metadata
+// block with the mmap-ed file, for events and metadata blocks that span the stream buffers
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "EventReader.h"
+#include "FileStream.h"
+#include "TestUtils.h"
+
+namespace
+{
+
+std::vector<SOCO::Event> readNextEvents(SOCO::EventReader& reader)
+{
+    std::vector<SOCO::Event> events;
+    SOCO::Event event;
+    while (reader.getNextEvent(event))
+    {
+        events.push_back(event);
+    }
+    return events;
+}
+
+std::vector<SOCO::Event> readBatches(SOCO::EventReader& reader)
+{
+    std::vector<SOCO::Event> events;
+    SOCO::EventBatch batch;
+    while (reader.readBatch(batch, 100))
+    {
+        for (size_t i = 0; i < batch.events; ++i)
+        {
+            SOCO::Event event;
+            event.trigger_id = batch.trigger_ids[i];
+            event.timestamp  = batch.event_timestamps[i];
+            for (size_t h = batch.offsets[i]; h < batch.offsets[i + 1]; ++h)
+            {
+                event.hits.emplace_back(batch.ids[h], batch.adcs[h], batch.timestamps[h]);
+            }
+            events.push_back(std::move(event));
+        }
+    }
+    return events;
+}
+
+std::vector<std::string> metadata(const SOCO::EventReader& reader)
+{
+    std::vector<std::string> blocks;
+    for (size_t i = 0; i < reader.metadataSize(); ++i)
+    {
+        blocks.push_back(reader[i]);
+    }
+    return blocks;
+}
+
+// A new streamed reader for every read, a reader maps only one file once
+SOCO::EventReader stream(const std::string& filename, const size_t memory)
+{
+    SOCO::EventReader reader;
+    reader.mapFile(filename, false, memory);
+    CHECK(reader.isStreamed());
+    return reader;
+}
+
+// Compares all access paths of the streamed reader with the mmap-ed reader
+void compare(const std::string& filename, const std::vector<std::string>& blocks)
+{
+    SOCO::EventReader mapped;
+    mapped.mapFile(filename);
+    const std::vector<SOCO::Event> expected = mapped.readAllEvents();
+    CHECK(metadata(mapped) == blocks);
+
+    SOCO::EventReader read;
+    read.mapFile(filename, false);
+    CHECK(test::sameEvents(read.readAllEvents(), expected));
+
+    // the smallest buffers and buffers that hold several events
+    for (size_t memory : {size_t(1), size_t(1) << 20})
+    {
+        SOCO::EventReader next = stream(filename, memory);
+        CHECK(metadata(next) == blocks);
+        CHECK(test::sameEvents(readNextEvents(next), expected));
+
+        SOCO::EventReader batches = stream(filename, memory);
+        CHECK(metadata(batches) == blocks);
+        CHECK(test::sameEvents(readBatches(batches), expected));
+
+        SOCO::EventReader all = stream(filename, memory);
+        CHECK(test::sameEvents(all.readAllEvents(), expected));
+    }
+}
+
+} // namespace {anonymous}
+
+int main()
+{
+    return test::run("StreamedReader", []() {
+        const std::string filename = "streamed_reader.evt";
+        // up to 255 hits, events of up to 3 KiB cross the buffer boundaries at many offsets
+        const auto events = test::randomEvents(5000, 255, 4);
+
+        // metadata blocks smaller and larger than a stream buffer
+        const size_t large                    = 3 * SOCO::FileStream::MIN_BUFFER + 5;
+        const std::vector<std::string> blocks = {
+            std::string(100, 'a'), std::string(large, 'b'), std::string(10, 'c')};
+        test::writeEventFile(filename, events, blocks);
+        compare(filename, blocks);
+
+        // a truncated last event is dropped by all readers
+        {
+            std::ofstream out(filename, std::ios::binary | std::ios::app);
+            const char partial[] = {10, 1, 0, 5, 0};
+            out.write(partial, sizeof(partial));
+        }
+        compare(filename, blocks);
+
+        test::writeEventFile(filename, events);
+        compare(filename, {});
+        std::remove(filename.c_str());
+    });
+}
@@ -0,0 +1,171 @@
+#ifndef SOCO2ROOT_TESTUTILS_H
+#define SOCO2ROOT_TESTUTILS_H
+
+/*
+soco2root - Convert soco2 event files to root
+https://gitlab.ikp.uni-koeln.de/jmayer/soco2root
+Copyright (C) 2017  Jan Mayer
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Helpers shared by the tests, each test is a plain executable run by ctest
+// A failed CHECK throws, main reports it and returns 1.
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Event.h"
+#include "EventWriter.h"
+
+#define CHECK(condition)                                                                           \
+    do                                                                                             \
+    {                                                                                              \
+        if (!(condition))                                                                          \
+        {                                                                                          \
+            throw std::runtime_error(std::string(__FILE__) + ":" + std::to_string(__LINE__) +      \
+                                     ": CHECK(" #condition ") failed");                            \
+        }                                                                                          \
+    } while (false)
+
+namespace test
+{
+
+// Events with increasing timestamps and random ids, adcs and multiplicities in [1, max_mult]
+// Every 20th event has no hit of its trigger detector, so its event timestamp is 0.
+inline std::vector<SOCO::Event> randomEvents(const size_t n,
+                                             const size_t max_mult,
+                                             const uint64_t seed)
+{
+    std::mt19937_64 random(seed);
+    std::vector<SOCO::Event> events(n);
+    uint64_t time = 1000000;
+    for (size_t i = 0; i < n; ++i)
+    {
+        SOCO::Event& event = events[i];
+        time += 100 + random() % 10000;
+        const size_t mult = 1 + random() % max_mult;
+        for (size_t h = 0; h < mult; ++h)
+        {
+            const uint16_t id  = static_cast<uint16_t>(random() % 64);
+            const uint16_t adc = static_cast<uint16_t>(random());
+            event.hits.emplace_back(id, adc, time - 200 + random() % 400);
+        }
+        event.trigger_id = (i % 20 == 0) ? 1000 : event.hits[random() % mult].id;
+    }
+    return events;
+}
+
+// Events with hits whose timestamps differ from the event timestamp by more than an int32, in both
+// directions and at the limits, so the relative layout escapes them (see SOCO::encodeTimestamps)
+inline std::vector<SOCO::Event> escapedEvents()
+{
+    const uint64_t t       = UINT64_C(1) << 40;
+    const int64_t deltas[] = {std::numeric_limits<int32_t>::min(),
+                              std::numeric_limits<int32_t>::min() + INT64_C(1),
+                              std::numeric_limits<int32_t>::max(),
+                              std::numeric_limits<int32_t>::max() + INT64_C(1),
+                              -static_cast<int64_t>(t),
+                              INT64_C(1) << 50,
+                              -1,
+                              1};
+    std::vector<SOCO::Event> events;
+    // the trigger hit sets the event timestamp t
+    SOCO::Event triggered;
+    triggered.trigger_id = 7;
+    for (const int64_t dt : deltas)
+    {
+        triggered.hits.emplace_back(1, 100, t + static_cast<uint64_t>(dt));
+    }
+    triggered.hits.emplace_back(7, 200, t);
+    events.push_back(triggered);
+
+    // only escaped hits
+    SOCO::Event escaped;
+    escaped.trigger_id = 7;
+    escaped.hits.emplace_back(7, 300, t);
+    escaped.hits.emplace_back(2, 301, t + std::numeric_limits<int32_t>::min());
+    escaped.hits.emplace_back(3, 302, t + (UINT64_C(1) << 33));
+    events.push_back(escaped);
+
+    // no trigger hit: event timestamp 0, hits beyond 2^31
+    SOCO::Event untriggered;
+    untriggered.trigger_id = 1000;
+    untriggered.hits.emplace_back(4, 400, std::numeric_limits<int32_t>::max());
+    untriggered.hits.emplace_back(5, 401, UINT64_C(1) << 31);
+    untriggered.hits.emplace_back(6, 402, t);
+    events.push_back(untriggered);
+    return events;
+}
+
+// Writes the events as soco2 event file, replacing an existing file
+inline void writeEventFile(const std::string& filename,
+                           const std::vector<SOCO::Event>& events,
+                           const std::vector<std::string>& metadata = std::vector<std::string>())
+{
+    SOCO::EventWriter writer(filename, metadata, SOCO::EventWriter::DEFAULT_BUFFER_SIZE, true);
+    for (const SOCO::Event& event : events)
+    {
+        writer.write(event);
+    }
+    writer.close();
+}
+
+inline bool sameEvent(const SOCO::Event& a, const SOCO::Event& b)
+{
+    return a.trigger_id == b.trigger_id && a.timestamp == b.timestamp && a.hits == b.hits;
+}
+
+inline bool sameEvents(const std::vector<SOCO::Event>& a, const std::vector<SOCO::Event>& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (!sameEvent(a[i], b[i]))
+        {
+            std::cout << "event " << i << " differs" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs test and reports the result, the return value of main
+template <class Test>
+int run(const char* name, Test test)
+{
+    try
+    {
+        test();
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << name << " FAILED: " << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << name << " passed" << std::endl;
+    return 0;
+}
+
+} // namespace test
+
+#endif // SOCO2ROOT_TESTUTILS_H